@@ -0,0 +1,178 @@
+#include <bits/stdc++.h>
+#include <malloc.h>
+
+#include "my_bench.hpp"
+#include "my_hash.hpp"
+#include "my_unordered_map.hpp"
+#include "my_vector.hpp"
+#include "orderBook.hpp"
+#include "util.hpp"
+
+/*
+ * My:: containers against their std:: counterparts, run with `make bench`
+ * Every pair is named "<what>/<My|std>" so they sort next to each other in
+ * the output and the JSON.
+ */
+
+using My::bench::do_not_optimize;
+
+namespace {
+
+const std::vector<std::int64_t> sizes = {1 << 10, 1 << 16, 1 << 20};
+
+std::vector<std::uint64_t> randomKeys(std::size_t n) {
+    std::mt19937_64 rng(42);
+    std::vector<std::uint64_t> keys(n);
+    for (auto &k : keys)
+        k = rng();
+    return keys;
+}
+
+// Ticker-like keys, the short string case My::hash is tuned for
+std::vector<std::string> symbolKeys(std::size_t n) {
+    std::mt19937_64 rng(7);
+    std::vector<std::string> keys(n);
+    for (auto &k : keys) {
+        k.resize(3 + rng() % 6);
+        for (auto &c : k)
+            c = static_cast<char>('A' + rng() % 26);
+    }
+    return keys;
+}
+
+/*** vector ***/
+template <class Vector>
+void pushBack(std::size_t iters, std::int64_t n) {
+    for (std::size_t i = 0; i < iters; ++i) {
+        Vector v;
+        for (std::int64_t j = 0; j < n; ++j)
+            v.push_back(static_cast<int>(j));
+        do_not_optimize(v.data());
+    }
+}
+
+template <class Vector>
+void pushBackStrings(std::size_t iters, std::int64_t n) {
+    for (std::size_t i = 0; i < iters; ++i) {
+        Vector v;
+        for (std::int64_t j = 0; j < n; ++j)
+            v.push_back(std::string(24, 'x'));
+        do_not_optimize(v.data());
+    }
+}
+
+template <class Vector>
+void copyVector(std::size_t iters, std::int64_t n) {
+    Vector src(static_cast<std::size_t>(n), 7);
+    for (std::size_t i = 0; i < iters; ++i) {
+        Vector copy(src);
+        do_not_optimize(copy.data());
+    }
+}
+
+/*** unordered_map ***/
+template <class Map>
+void mapInsert(std::size_t iters, std::int64_t n) {
+    const auto keys = randomKeys(n);
+    for (std::size_t i = 0; i < iters; ++i) {
+        Map m;
+        for (auto k : keys)
+            m.emplace(k, k);
+        do_not_optimize(m);
+    }
+}
+
+// Filled once per size, one iteration is one lookup (always a hit)
+template <class Map, class Keys>
+My::bench::suite::body mapFind(Keys keys) {
+    auto m = std::make_shared<Map>();
+    for (std::size_t i = 0; i < keys.size(); ++i)
+        m->emplace(keys[i], typename Map::mapped_type(i));
+
+    return [m, keys = std::move(keys)](std::size_t iters) {
+        std::size_t hits = 0;
+        for (std::size_t i = 0, j = 0; i < iters; ++i, j = j + 1 == keys.size() ? 0 : j + 1)
+            hits += m->find(keys[j]) != m->end();
+        do_not_optimize(hits);
+    };
+}
+
+/*** hash, one iteration is one hash ***/
+template <class Hash, class Keys>
+void hashKeys(std::size_t iters, const Keys &keys) {
+    Hash h;
+    std::size_t acc = 0;
+    for (std::size_t i = 0, j = 0; i < iters; ++i, j = j + 1 == keys.size() ? 0 : j + 1)
+        acc ^= h(keys[j]);
+    do_not_optimize(acc);
+}
+
+/*** OrderBook, one iteration is a book of n orders added then cancelled ***/
+void orderBookAddCancel(std::size_t iters, std::int64_t n) {
+    std::mt19937_64 rng(1);
+    std::vector<Order> orders;
+    orders.reserve(n);
+    for (std::int64_t i = 0; i < n; ++i) {
+        // Bids under 100, asks over, so nothing crosses and every order rests
+        const bool bid = rng() & 1;
+        const Price px = bid ? 99.0f - static_cast<Price>(rng() % 50) * 0.01f
+                             : 100.0f + static_cast<Price>(rng() % 50) * 0.01f;
+        orders.emplace_back(static_cast<OrderId>(i), bid ? Side::Bid : Side::Ask, px,
+                            static_cast<Volume>(1 + rng() % 100));
+    }
+
+    for (std::size_t i = 0; i < iters; ++i) {
+        OrderBook book;
+        for (const auto &o : orders)
+            book.addOrder(o);
+        do_not_optimize(book.getBestBid());
+        for (const auto &o : orders)
+            book.cancelOrder(o.id);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    // glibc raises its mmap threshold the first time a big block is freed,
+    // so whichever benchmark ran first paid mmap + page faults on every grow
+    // and the ones after it didn't (3x on push_back/65536). Pinning the
+    // threshold makes every benchmark see the same malloc
+    mallopt(M_MMAP_THRESHOLD, 128 * 1024);
+
+    My::bench::suite s("containers");
+
+    s.add("vector/push_back/My", sizes, pushBack<My::vector<int>>);
+    s.add("vector/push_back/std", sizes, pushBack<std::vector<int>>);
+    s.add("vector/push_back_string/My", {1 << 10, 1 << 16}, pushBackStrings<My::vector<std::string>>);
+    s.add("vector/push_back_string/std", {1 << 10, 1 << 16}, pushBackStrings<std::vector<std::string>>);
+    s.add("vector/copy/My", sizes, copyVector<My::vector<int>>);
+    s.add("vector/copy/std", sizes, copyVector<std::vector<int>>);
+
+    using my_map  = My::unordered_map<std::uint64_t, std::uint64_t>;
+    using std_map = std::unordered_map<std::uint64_t, std::uint64_t>;
+    s.add("unordered_map/insert/My", sizes, mapInsert<my_map>);
+    s.add("unordered_map/insert/std", sizes, mapInsert<std_map>);
+    s.add_fixture("unordered_map/find/My", sizes,
+                  [](std::int64_t n) { return mapFind<my_map>(randomKeys(n)); });
+    s.add_fixture("unordered_map/find/std", sizes,
+                  [](std::int64_t n) { return mapFind<std_map>(randomKeys(n)); });
+    s.add_fixture("unordered_map/find_symbol/My", {1 << 10, 1 << 16},
+                  [](std::int64_t n) { return mapFind<My::unordered_map<std::string, int>>(symbolKeys(n)); });
+    s.add_fixture("unordered_map/find_symbol/std", {1 << 10, 1 << 16},
+                  [](std::int64_t n) { return mapFind<std::unordered_map<std::string, int>>(symbolKeys(n)); });
+
+    static const auto ints = randomKeys(1 << 12);
+    static const auto symbols = symbolKeys(1 << 12);
+    static const std::vector<std::string> longStrings(1 << 8, std::string(128, 'q'));
+    s.add("hash/int/My", [](std::size_t n) { hashKeys<My::hash<std::uint64_t>>(n, ints); });
+    s.add("hash/int/std", [](std::size_t n) { hashKeys<std::hash<std::uint64_t>>(n, ints); });
+    s.add("hash/symbol/My", [](std::size_t n) { hashKeys<My::hash<std::string>>(n, symbols); });
+    s.add("hash/symbol/std", [](std::size_t n) { hashKeys<std::hash<std::string>>(n, symbols); });
+    s.add("hash/string128/My", [](std::size_t n) { hashKeys<My::hash<std::string>>(n, longStrings); });
+    s.add("hash/string128/std", [](std::size_t n) { hashKeys<std::hash<std::string>>(n, longStrings); });
+
+    s.add("orderbook/add_cancel", {1 << 10, 1 << 14}, orderBookAddCancel);
+
+    return s.main(argc, argv);
+}
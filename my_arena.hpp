@@ -0,0 +1,226 @@
+#pragma once
+
+#include <bits/stdc++.h>
+#include <memory_resource>
+
+namespace My {
+
+/*
+ * Monotonic arena, std::pmr::monotonic_buffer_resource with a reset()
+ * Allocation bumps a pointer through the current chunk, deallocation does
+ * nothing and everything is freed at once by reset() or the destructor. Good
+ * for scratch containers that all die together, e.g. everything built while
+ * handling one message:
+ *
+ *   My::arena scratch(64 << 10);
+ *   for (auto &msg : feed) {
+ *       My::vector<int, My::arena_allocator<int>> ids(scratch);
+ *       ...
+ *       scratch.reset();   // ids must be gone by now
+ *   }
+ *
+ * It starts in an optional caller buffer (e.g. on the stack), then takes
+ * geometrically bigger chunks from upstream. Without an upstream it throws
+ * std::bad_alloc once the buffer runs out.
+ *
+ * It is a std::pmr::memory_resource, so std::pmr::polymorphic_allocator works
+ * with it too. arena_allocator below is the non virtual version.
+ *
+ * NOTE: not thread safe, use one arena per thread
+ */
+
+class arena : public std::pmr::memory_resource {
+public:
+    static constexpr std::size_t default_chunk_size = 4096;
+
+    explicit arena(std::size_t chunkSize = default_chunk_size,
+                   std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+    : _upstream(upstream), _next_chunk_size(std::max(chunkSize, min_chunk_size))
+    {}
+
+    // Hands out buffer first, upstream can be nullptr for a fixed size arena
+    arena(void *buffer, std::size_t size,
+          std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+    : _upstream(upstream), _next_chunk_size(std::max(size, min_chunk_size)),
+      _buffer(static_cast<std::byte*>(buffer)), _buffer_size(size),
+      _cur(_buffer), _end(_buffer + size)
+    {}
+
+    arena(const arena&) = delete;
+    arena &operator=(const arena&) = delete;
+
+    ~arena() override { release(); }
+
+    // Inline and non virtual, arena_allocator calls this directly
+    void* allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t)) {
+        std::byte *p = alignPtr(_cur, align);
+
+        if (p > _end || bytes > static_cast<std::size_t>(_end - p)) [[unlikely]]
+            p = refill(bytes, align);
+
+        _cur = p + bytes;
+        _used += bytes;
+        return p;
+    }
+
+    void deallocate(void*, std::size_t, std::size_t = alignof(std::max_align_t)) noexcept {}
+
+    // Frees everything but keeps the biggest chunk so a steady state workload
+    // stops going upstream after the first few rounds
+    void reset() noexcept {
+        chunk_header *keep = nullptr;
+
+        while (_chunks) {
+            chunk_header *next = _chunks->next;
+            if (!keep || _chunks->size > keep->size) {
+                if (keep)
+                    freeChunk(keep);
+                keep = _chunks;
+            } else {
+                freeChunk(_chunks);
+            }
+            _chunks = next;
+        }
+
+        _chunks = keep;
+        _used = 0;
+
+        if (keep) {
+            keep->next = nullptr;
+            _cur = chunkData(keep);
+            _end = reinterpret_cast<std::byte*>(keep) + keep->size;
+        } else {
+            _cur = _buffer;
+            _end = _buffer + _buffer_size;
+        }
+    }
+
+    // Frees everything and gives every chunk back to upstream
+    void release() noexcept {
+        while (_chunks) {
+            chunk_header *next = _chunks->next;
+            freeChunk(_chunks);
+            _chunks = next;
+        }
+
+        _cur = _buffer;
+        _end = _buffer + _buffer_size;
+        _used = 0;
+    }
+
+    // Bytes handed out since the last reset, not counting alignment padding
+    std::size_t bytes_used() const noexcept { return _used; }
+
+    // Bytes held from upstream (chunk headers included)
+    std::size_t bytes_reserved() const noexcept {
+        std::size_t out = 0;
+        for (auto c = _chunks; c; c = c->next)
+            out += c->size;
+        return out;
+    }
+
+    std::pmr::memory_resource* upstream_resource() const noexcept { return _upstream; }
+
+private:
+    struct chunk_header {
+        chunk_header *next;
+        std::size_t   size;
+    };
+
+    static constexpr std::size_t min_chunk_size = 256;
+
+    std::pmr::memory_resource *_upstream;
+    std::size_t                _next_chunk_size;
+
+    std::byte                 *_buffer      = nullptr;
+    std::size_t                _buffer_size = 0;
+
+    chunk_header              *_chunks = nullptr;
+    std::byte                 *_cur    = nullptr;
+    std::byte                 *_end    = nullptr;
+    std::size_t                _used   = 0;
+
+    static std::byte* alignPtr(std::byte *p, std::size_t align) noexcept {
+        const auto raw = reinterpret_cast<std::uintptr_t>(p);
+        return reinterpret_cast<std::byte*>((raw + align - 1) & ~(align - 1));
+    }
+
+    static std::byte* chunkData(chunk_header *c) noexcept {
+        return reinterpret_cast<std::byte*>(c) + sizeof(chunk_header);
+    }
+
+    void freeChunk(chunk_header *c) noexcept {
+        _upstream->deallocate(c, c->size, alignof(std::max_align_t));
+    }
+
+    // Slow path, starts a new chunk big enough for bytes at align
+    std::byte* refill(std::size_t bytes, std::size_t align) {
+        if (!_upstream)
+            throw(std::bad_alloc());
+
+        const std::size_t needed = sizeof(chunk_header) + bytes + align;
+        const std::size_t size = std::max(_next_chunk_size, needed);
+
+        auto *c = static_cast<chunk_header*>(_upstream->allocate(size, alignof(std::max_align_t)));
+        c->next = _chunks;
+        c->size = size;
+        _chunks = c;
+        _next_chunk_size = size * 2;
+
+        _end = reinterpret_cast<std::byte*>(c) + size;
+        return alignPtr(chunkData(c), align);
+    }
+
+    /*** std::pmr::memory_resource ***/
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        return allocate(bytes, align);
+    }
+
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+/*
+ * Allocator adaptor for My::arena, a pointer to the arena and nothing else.
+ * Like std::pmr::polymorphic_allocator it never propagates: a container
+ * keeps the arena it was built with through copy/move assignment and swap,
+ * and moving between containers on different arenas copies the elements.
+ */
+template <class T>
+class arena_allocator {
+public:
+    using value_type = T;
+
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::false_type;
+    using propagate_on_container_swap            = std::false_type;
+    using is_always_equal                        = std::false_type;
+
+    arena_allocator(arena &a) noexcept : _arena(&a) {}
+
+    template <class U>
+    arena_allocator(const arena_allocator<U> &other) noexcept : _arena(other.resource()) {}
+
+    T* allocate(std::size_t n) {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+            throw(std::bad_array_new_length());
+
+        return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, std::size_t) noexcept {}
+
+    arena* resource() const noexcept { return _arena; }
+
+    friend bool operator==(const arena_allocator &lhs, const arena_allocator &rhs) noexcept {
+        return lhs.resource() == rhs.resource();
+    }
+
+private:
+    arena *_arena;
+};
+
+} // namespace My
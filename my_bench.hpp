@@ -0,0 +1,259 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+#include "util.hpp"
+
+namespace My {
+
+/*
+ * Microbenchmark harness, not defined in STL (think a small Google Benchmark)
+ * A benchmark is a function that runs its body iters times:
+ *
+ *   My::bench::suite s("containers");
+ *   s.add("vector/push_back", {1 << 10, 1 << 20}, [](std::size_t iters, std::int64_t n) {
+ *       for (std::size_t i = 0; i < iters; ++i) {
+ *           My::vector<int> v;
+ *           for (int j = 0; j < n; ++j) v.push_back(j);
+ *           My::bench::do_not_optimize(v);
+ *       }
+ *   });
+ *   return s.main(argc, argv);     // --filter=, --json=, --reps=, --min-ms=
+ *
+ * When the body needs data built first (a filled map to look things up in),
+ * add_fixture takes a setup that runs once per param, untimed, and returns
+ * the body:
+ *
+ *   s.add_fixture("map/find", {1 << 20}, [](std::int64_t n) {
+ *       auto m = std::make_shared<My::unordered_map<int, int>>(fill(n));
+ *       return [m](std::size_t iters) { ... };
+ *   });
+ *
+ * For every (benchmark, param) the harness
+ *  - calibrates: grows iters until one run takes min_ms
+ *  - warms up: one run at that count, thrown away
+ *  - runs reps repetitions and reports the median time per iteration and
+ *    the MAD (median absolute deviation), which unlike the mean and the
+ *    standard deviation don't care about the odd run hit by an interrupt
+ *
+ * Results go to stdout as a table and optionally to a JSON file, so runs
+ * from different commits can be diffed.
+ */
+
+namespace bench {
+
+// Makes the compiler assume value is read, so the work producing it stays
+template <class T>
+inline void do_not_optimize(T const &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <class T>
+inline void do_not_optimize(T &value) {
+    asm volatile("" : "+r,m"(value) : : "memory");
+}
+
+// Makes the compiler assume all memory was read and written
+inline void clobber_memory() {
+    asm volatile("" : : : "memory");
+}
+
+struct result {
+    std::string  name;
+    std::int64_t param = 0;
+    bool         has_param = false;
+    std::size_t  iterations = 0;   // Per repetition
+    std::size_t  repetitions = 0;
+    double       median_ns = 0;    // Per iteration
+    double       mad_ns = 0;
+    double       min_ns = 0;
+};
+
+struct options {
+    std::string filter;            // Substring of "name" or "name/param"
+    std::string json_path;
+    std::size_t repetitions = 9;
+    double      min_ms = 20;       // Per repetition
+};
+
+namespace detail {
+
+inline double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    const std::size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+inline double mad(const std::vector<double> &v, double med) {
+    std::vector<double> dev;
+    dev.reserve(v.size());
+    for (double x : v)
+        dev.push_back(std::abs(x - med));
+    return median(std::move(dev));
+}
+
+inline std::string jsonEscape(const std::string &s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+} // namespace detail
+
+class suite {
+public:
+    using body    = std::function<void(std::size_t iters)>;
+    using fixture = std::function<body(std::int64_t param)>;
+
+    explicit suite(std::string name) : _name(std::move(name)) {}
+
+    // Runs once per param, a parameter sweep
+    void add(std::string name, std::vector<std::int64_t> params,
+             std::function<void(std::size_t iters, std::int64_t param)> f) {
+        add_fixture(std::move(name), std::move(params), [f = std::move(f)](std::int64_t param) -> body {
+            return [f, param](std::size_t iters) { f(iters, param); };
+        });
+    }
+
+    void add(std::string name, body f) {
+        _cases.push_back({std::move(name), {0}, false, [f = std::move(f)](std::int64_t) { return f; }});
+    }
+
+    void add_fixture(std::string name, std::vector<std::int64_t> params, fixture setup) {
+        _cases.push_back({std::move(name), std::move(params), true, std::move(setup)});
+    }
+
+    std::vector<result> run(const options &opt) const {
+        std::vector<result> out;
+
+        for (const auto &c : _cases) {
+            for (std::int64_t param : c.params) {
+                const std::string label = c.has_param ? c.name + "/" + std::to_string(param) : c.name;
+                if (!opt.filter.empty() && label.find(opt.filter) == std::string::npos)
+                    continue;
+
+                out.push_back(measure(c, param, opt));
+                print(out.back(), label);
+            }
+        }
+        return out;
+    }
+
+    void write_json(const std::vector<result> &results, const std::string &path) const {
+        std::ofstream os(path);
+        if (!os)
+            throw(std::runtime_error("bench: can't write " + path));
+
+        os << "{\n  \"suite\": \"" << detail::jsonEscape(_name) << "\",\n  \"results\": [\n";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const result &r = results[i];
+            os << "    {\"name\": \"" << detail::jsonEscape(r.name) << "\"";
+            if (r.has_param)
+                os << ", \"param\": " << r.param;
+            os << ", \"iterations\": " << r.iterations
+               << ", \"repetitions\": " << r.repetitions
+               << std::fixed << std::setprecision(3)
+               << ", \"median_ns\": " << r.median_ns
+               << ", \"mad_ns\": " << r.mad_ns
+               << ", \"min_ns\": " << r.min_ns << "}"
+               << (i + 1 < results.size() ? ",\n" : "\n");
+            os.unsetf(std::ios::floatfield);
+        }
+        os << "  ]\n}\n";
+    }
+
+    // Parses the command line, runs and writes the JSON if asked to
+    int main(int argc, char **argv) const {
+        options opt;
+        for (int i = 1; i < argc; ++i) {
+            std::string_view arg = argv[i];
+            auto value = [&](std::string_view key) -> std::optional<std::string> {
+                if (arg.starts_with(key))
+                    return std::string(arg.substr(key.size()));
+                return std::nullopt;
+            };
+
+            if (auto v = value("--filter="))       opt.filter = *v;
+            else if (auto v = value("--json="))    opt.json_path = *v;
+            else if (auto v = value("--reps="))    opt.repetitions = std::max(1ul, std::stoul(*v));
+            else if (auto v = value("--min-ms="))  opt.min_ms = std::stod(*v);
+            else {
+                std::cerr << "usage: " << argv[0]
+                          << " [--filter=substr] [--json=path] [--reps=n] [--min-ms=ms]\n";
+                return 1;
+            }
+        }
+
+        const auto results = run(opt);
+        if (!opt.json_path.empty())
+            write_json(results, opt.json_path);
+        return 0;
+    }
+
+private:
+    struct bench_case {
+        std::string               name;
+        std::vector<std::int64_t> params;
+        bool                      has_param;
+        fixture                   setup;
+    };
+
+    std::string             _name;
+    std::vector<bench_case> _cases;
+
+    static double timeRun(const body &f, std::size_t iters) {
+        clobber_memory();
+        const timePoint start = curr_time();
+        f(iters);
+        const timePoint end = curr_time();
+        clobber_memory();
+        return static_cast<double>(diff_time<nanoseconds>(start, end).count());
+    }
+
+    static result measure(const bench_case &c, std::int64_t param, const options &opt) {
+        const double target_ns = opt.min_ms * 1e6;
+        const body f = c.setup(param);
+
+        // Calibrate, the last run doubles as part of the warmup
+        std::size_t iters = 1;
+        for (;;) {
+            const double ns = timeRun(f, iters);
+            if (ns >= target_ns || iters >= (std::size_t{1} << 40))
+                break;
+            // Jump straight to about the right count once the timing means something
+            const double scale = ns > 1e5 ? std::min(target_ns / ns * 1.2, 10.0) : 10.0;
+            iters = std::max(iters + 1, static_cast<std::size_t>(iters * scale));
+        }
+        timeRun(f, iters);
+
+        std::vector<double> perIter;
+        perIter.reserve(opt.repetitions);
+        for (std::size_t r = 0; r < opt.repetitions; ++r)
+            perIter.push_back(timeRun(f, iters) / static_cast<double>(iters));
+
+        result out;
+        out.name = c.name;
+        out.param = param;
+        out.has_param = c.has_param;
+        out.iterations = iters;
+        out.repetitions = opt.repetitions;
+        out.median_ns = detail::median(perIter);
+        out.mad_ns = detail::mad(perIter, out.median_ns);
+        out.min_ns = *std::min_element(perIter.begin(), perIter.end());
+        return out;
+    }
+
+    static void print(const result &r, const std::string &label) {
+        std::printf("%-44s %14.2f ns  +- %6.2f%%  (%zu iters x %zu)\n", label.c_str(), r.median_ns,
+                    r.median_ns > 0 ? 100 * r.mad_ns / r.median_ns : 0.0, r.iterations, r.repetitions);
+        std::fflush(stdout);
+    }
+};
+
+} // namespace bench
+
+} // namespace My
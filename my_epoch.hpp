@@ -0,0 +1,285 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+#include "my_unique_ptr.hpp"
+
+namespace My {
+
+/*
+ * Epoch based reclamation, not defined in STL
+ * For structures that are read all the time and swapped out now and then
+ * (instrument tables, book snapshots): readers follow plain atomic pointers
+ * with no locks and no reference counts, writers publish a new version and
+ * retire() the old one, which is deleted once no reader can still be on it.
+ *
+ *   std::atomic<table*> current;
+ *
+ *   // reader
+ *   My::epoch_guard guard;                       // pin
+ *   const table *t = current.load(std::memory_order_acquire);
+ *   ... use t until guard goes out of scope ...
+ *
+ *   // writer
+ *   table *old = current.exchange(fresh, std::memory_order_acq_rel);
+ *   My::epoch_domain::global().retire(old);      // or retire(old, deleter)
+ *
+ * How it works: there's a global epoch, and every thread has a record with
+ * the epoch it pinned at (0 when it isn't reading). Something retired during
+ * epoch e can only be reached by readers pinned at e or earlier, and the
+ * global epoch only moves from e to e + 1 once every pinned reader is at e,
+ * so by e + 2 nobody can reach it. Retired pointers collect in a per thread
+ * list, every retire_batch of them the thread tries to move the epoch along
+ * and frees what's old enough.
+ *
+ * A pin is a store to the thread's own record and a fence, no RMW on shared
+ * lines, and nested pins just bump a counter.
+ *
+ * NOTE: a reader that stays pinned stops all reclamation, keep guards short.
+ *       Domains other than global() have to outlive the threads using them
+ */
+
+class epoch_domain {
+public:
+    // Retired pointers a thread holds before it tries to free some
+    static constexpr std::size_t retire_batch = 64;
+
+    epoch_domain() = default;
+    epoch_domain(const epoch_domain&) = delete;
+    epoch_domain &operator=(const epoch_domain&) = delete;
+
+    // No readers are left by now, so everything still retired goes
+    ~epoch_domain() {
+        for (record *r = _records.load(std::memory_order_acquire); r;) {
+            record *next = r->next;
+            freeAll(r->retired);
+            delete r;
+            r = next;
+        }
+        freeAll(_orphans);
+    }
+
+    // Shared domain for everything that doesn't need its own
+    static epoch_domain& global() {
+        static epoch_domain domain;
+        return domain;
+    }
+
+    /*** Readers ***/
+    void pin() {
+        record &r = local();
+        if (r.depth++)
+            return;
+
+        r.epoch.store(_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        // Pairs with the fence in tryAdvance: either the scan sees this pin
+        // or every load after this fence sees what was unlinked before it
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    void unpin() noexcept {
+        record &r = *cached();
+        if (--r.depth)
+            return;
+
+        r.epoch.store(0, std::memory_order_release);
+    }
+
+    /*** Writers ***/
+    // d(p) runs once no reader can still see p, the Deleter is the same kind
+    // unique_ptr takes. p has to be unreachable for new readers already
+    template <class T, class Deleter = std::default_delete<T>>
+    void retire(T *p, Deleter d = Deleter()) {
+        if (!p)
+            return;
+
+        retired_entry e{p, nullptr, nullptr, 0};
+        if constexpr (std::is_empty_v<Deleter> && std::is_default_constructible_v<Deleter>) {
+            static_cast<void>(d);
+            e.call = [](void *ptr, void*) { Deleter()(static_cast<T*>(ptr)); };
+        } else {
+            e.state = new Deleter(std::move(d));
+            e.call = [](void *ptr, void *state) {
+                std::unique_ptr<Deleter> del(static_cast<Deleter*>(state));
+                (*del)(static_cast<T*>(ptr));
+            };
+        }
+
+        record &r = local();
+        e.epoch = _epoch.load(std::memory_order_seq_cst);
+        r.retired.push_back(e);
+
+        if (r.retired.size() >= r.next_collect)
+            collect(r);
+    }
+
+    // Takes the pointer out of the unique_ptr, its deleter does the freeing
+    template <class T, class Deleter>
+    void retire(unique_ptr<T, Deleter> &&p) {
+        Deleter d = std::move(p.get_deleter());
+        retire(p.release(), std::move(d));
+    }
+
+    // Frees everything retired so far, waiting for readers as needed. For
+    // shutdown and tests, never call it while pinned
+    void synchronize() {
+        record &r = local();
+        for (;;) {
+            collect(r);
+            if (r.retired.empty() && orphansEmpty())
+                return;
+            std::this_thread::yield();
+        }
+    }
+
+    std::uint64_t epoch() const noexcept { return _epoch.load(std::memory_order_relaxed); }
+
+    // Retired by this thread and not freed yet
+    std::size_t pending() { return local().retired.size(); }
+
+private:
+    struct retired_entry {
+        void          *ptr;
+        void          *state;                   // Heap copy of a stateful deleter
+        void         (*call)(void*, void*);
+        std::uint64_t  epoch;
+    };
+
+    struct alignas(64) record {
+        std::atomic<std::uint64_t> epoch{0};     // 0 when not pinned
+        std::atomic<bool>          in_use{true};
+        record                    *next = nullptr;
+
+        // Only touched by the owning thread
+        std::size_t                depth = 0;
+        std::vector<retired_entry> retired;
+        std::size_t                next_collect = retire_batch;
+    };
+
+    std::atomic<std::uint64_t> _epoch{1};
+    std::atomic<record*>       _records{nullptr};   // Push only, reused through in_use
+
+    std::mutex                 _orphan_mutex;
+    std::vector<retired_entry> _orphans;            // Left behind by exited threads
+
+    // Gives the thread's records back when it exits
+    struct thread_records {
+        std::vector<std::pair<epoch_domain*, record*>> owned;
+
+        ~thread_records() {
+            for (auto [domain, r] : owned)
+                domain->releaseRecord(r);
+        }
+    };
+
+    static thread_records& threadRecords() {
+        static thread_local thread_records records;
+        return records;
+    }
+
+    record* cached() noexcept {
+        for (auto [domain, r] : threadRecords().owned)
+            if (domain == this)
+                return r;
+        return nullptr;
+    }
+
+    record& local() {
+        if (record *r = cached()) [[likely]]
+            return *r;
+
+        record *r = acquireRecord();
+        threadRecords().owned.emplace_back(this, r);
+        return *r;
+    }
+
+    record* acquireRecord() {
+        for (record *r = _records.load(std::memory_order_acquire); r; r = r->next) {
+            bool free = false;
+            if (!r->in_use.load(std::memory_order_relaxed)
+                && r->in_use.compare_exchange_strong(free, true, std::memory_order_acquire))
+                return r;
+        }
+
+        auto *r = new record;
+        r->next = _records.load(std::memory_order_relaxed);
+        while (!_records.compare_exchange_weak(r->next, r, std::memory_order_release,
+                                               std::memory_order_relaxed)) {}
+        return r;
+    }
+
+    void releaseRecord(record *r) {
+        if (!r->retired.empty()) {
+            std::lock_guard<std::mutex> lock(_orphan_mutex);
+            _orphans.insert(_orphans.end(), r->retired.begin(), r->retired.end());
+            r->retired.clear();
+        }
+        r->depth = 0;
+        r->next_collect = retire_batch;
+        r->epoch.store(0, std::memory_order_relaxed);
+        r->in_use.store(false, std::memory_order_release);
+    }
+
+    // Moves the global epoch on if every pinned reader is in the current one
+    void tryAdvance() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        std::uint64_t e = _epoch.load(std::memory_order_relaxed);
+        for (record *r = _records.load(std::memory_order_acquire); r; r = r->next) {
+            const std::uint64_t pinned = r->epoch.load(std::memory_order_relaxed);
+            if (pinned && pinned != e)
+                return;
+        }
+
+        _epoch.compare_exchange_strong(e, e + 1, std::memory_order_acq_rel);
+    }
+
+    static void freeAll(std::vector<retired_entry> &entries) noexcept {
+        for (auto &e : entries)
+            e.call(e.ptr, e.state);
+        entries.clear();
+    }
+
+    // Frees the entries at least two epochs old, keeping the rest in order
+    static void freeExpired(std::vector<retired_entry> &entries, std::uint64_t now) noexcept {
+        auto keep = std::stable_partition(entries.begin(), entries.end(),
+                                          [now](const retired_entry &e) { return e.epoch + 2 > now; });
+        for (auto it = keep; it != entries.end(); ++it)
+            it->call(it->ptr, it->state);
+        entries.erase(keep, entries.end());
+    }
+
+    void collect(record &r) {
+        tryAdvance();
+        const std::uint64_t now = _epoch.load(std::memory_order_acquire);
+
+        // Everything an unpinned thread retired is at most 2 epochs from
+        // free, so don't rescan until the list has grown by another batch
+        freeExpired(r.retired, now);
+        r.next_collect = r.retired.size() + retire_batch;
+
+        std::unique_lock<std::mutex> lock(_orphan_mutex, std::try_to_lock);
+        if (lock.owns_lock())
+            freeExpired(_orphans, now);
+    }
+
+    bool orphansEmpty() {
+        std::lock_guard<std::mutex> lock(_orphan_mutex);
+        return _orphans.empty();
+    }
+};
+
+// Pins the calling thread for its lifetime
+class epoch_guard {
+public:
+    explicit epoch_guard(epoch_domain &domain = epoch_domain::global()) : _domain(domain) { _domain.pin(); }
+    ~epoch_guard() { _domain.unpin(); }
+
+    epoch_guard(const epoch_guard&) = delete;
+    epoch_guard &operator=(const epoch_guard&) = delete;
+
+private:
+    epoch_domain &_domain;
+};
+
+} // namespace My
@@ -0,0 +1,449 @@
+#pragma once
+
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "my_unordered_map.hpp"
+
+namespace My {
+
+/*
+ * Read only hash map, not defined in STL
+ * Built once from a My::unordered_map or a range of pairs and never modified
+ * after. Everything lives in one contiguous, pointer free blob so it can be
+ * written to a file and mmap'd back by another process with no parsing:
+ *
+ *   frozen_map_header
+ *   offsets[bucket_count + 1]  bucket b owns slots [offsets[b], offsets[b + 1])
+ *   hashes[size]               cached so a miss rarely touches the entries
+ *   entries[size]              {key, value}, grouped by bucket
+ *
+ * bucket_count is a power of two and the bucket is picked with fibonacci
+ * hashing (multiply then keep the top bits) so even an identity hash like
+ * libstdc++'s std::hash<int> spreads out.
+ *
+ * NOTE: the file stores raw hashes, so Hash has to give the same result in
+ *       the process that builds the map and the ones that open it
+ *       (My::hash does, std::hash<std::string> isn't promised to)
+ */
+
+constexpr std::uint32_t frozen_map_version = 1;
+constexpr char frozen_map_magic[8] = {'M', 'Y', 'F', 'R', 'O', 'Z', 'E', 'N'};
+
+struct frozen_map_header {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t key_size;
+    std::uint32_t value_size;
+    std::uint32_t bucket_shift;  // 64 - log2(bucket_count)
+    std::uint64_t size;
+    std::uint64_t bucket_count;
+    std::uint64_t offsets_at;    // Byte offsets from the start of the blob
+    std::uint64_t hashes_at;
+    std::uint64_t entries_at;
+    std::uint64_t total_bytes;
+};
+
+template <typename Key, typename T>
+struct frozen_entry {
+    Key first;
+    T   second;
+};
+
+template <typename Key,
+          typename T,
+          typename Hash     = My::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class frozen_map {
+public:
+    using key_type        = Key;
+    using mapped_type     = T;
+    using value_type      = frozen_entry<Key, T>;
+    using size_type       = std::size_t;
+    using hasher          = Hash;
+    using key_equal       = KeyEqual;
+
+    using const_reference = const value_type&;
+    using const_pointer   = const value_type*;
+    using const_iterator  = const_pointer;
+    using iterator        = const_iterator;
+
+    static_assert(std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<T>,
+                  "frozen_map stores raw bytes, Key and T must be trivially copyable");
+    static_assert(alignof(value_type) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                  "frozen_map entries can't be over aligned");
+
+
+    /*** Constructors and Destructors***/
+    // Points at the shared empty blob, nothing is allocated
+    frozen_map(const Hash &hash = Hash(), const key_equal &equal = key_equal())
+        : _hash_function(hash), _key_eq(equal)
+    {}
+
+    // Later duplicates of a key are dropped, same as unordered_map::insert
+    template <class InputIt>
+    frozen_map(InputIt first, InputIt last,
+               const Hash &hash = Hash(),
+               const key_equal &equal = key_equal());
+
+    template <class H, class E, class A>
+    explicit frozen_map(const unordered_map<Key, T, H, E, A> &map,
+                        const Hash &hash = Hash(),
+                        const key_equal &equal = key_equal());
+
+    // other is left empty, like the containers
+    frozen_map(frozen_map &&other) noexcept { swap(other); }
+    frozen_map &operator=(frozen_map &&other) noexcept {
+        frozen_map temp(std::move(other));
+        swap(temp);
+        return *this;
+    }
+
+    frozen_map(const frozen_map &) = delete;
+    frozen_map &operator=(const frozen_map &) = delete;
+
+    ~frozen_map() {
+        if (_mapped)
+            ::munmap(_mapped, _mapped_bytes);
+    }
+
+    void swap(frozen_map &other) noexcept {
+        std::swap(_owned, other._owned);
+        std::swap(_mapped, other._mapped);
+        std::swap(_mapped_bytes, other._mapped_bytes);
+        std::swap(_header, other._header);
+        std::swap(_offsets, other._offsets);
+        std::swap(_hashes, other._hashes);
+        std::swap(_entries, other._entries);
+        std::swap(_hash_function, other._hash_function);
+        std::swap(_key_eq, other._key_eq);
+    }
+
+    /*** Persistence ***/
+    // Writes the blob as is, open() maps it straight back
+    void save(const std::string &path) const;
+
+    // mmaps the file read only, lookups run directly on the mapping
+    static frozen_map open(const std::string &path,
+                           const Hash &hash = Hash(),
+                           const key_equal &equal = key_equal());
+
+    /*** Lookup ***/
+    const_pointer find(const Key &key) const {
+        const std::uint64_t hash = _hash_function(key);
+        const std::uint64_t b = bucket(hash);
+
+        for (auto i = _offsets[b], last = _offsets[b + 1]; i < last; ++i)
+            if (_hashes[i] == hash && _key_eq(_entries[i].first, key))
+                return _entries + i;
+
+        return nullptr;
+    }
+
+    bool contains(const Key &key) const { return find(key) != nullptr; }
+    size_type count(const Key &key) const { return contains(key); }
+
+    const T& at(const Key &key) const {
+        if (auto e = find(key))
+            return e->second;
+
+        throw(std::out_of_range("No key found"));
+    }
+
+    /*** Iterators ***/
+    const_iterator begin() const noexcept { return _entries; }
+    const_iterator end() const noexcept { return _entries + size(); }
+
+    /*** Capacity ***/
+    bool empty()     const noexcept { return !size(); }
+    size_type size() const noexcept { return _header->size; }
+
+    /*** Bucket interface ***/
+    size_type bucket_count() const noexcept { return _header->bucket_count; }
+
+    // Size of the blob, i.e. of the file written by save()
+    size_type bytes() const noexcept { return _header->total_bytes; }
+
+private:
+    // What build() makes from no items: two empty buckets, laid out like
+    // any other blob so lookups and save() need no special case
+    struct empty_blob {
+        frozen_map_header header;
+        std::uint64_t     offsets[3];
+    };
+    static const empty_blob _empty;
+
+    std::unique_ptr<std::byte[]> _owned;
+    void                        *_mapped       = nullptr;
+    size_type                    _mapped_bytes = 0;
+
+    const frozen_map_header     *_header  = &_empty.header;
+    const std::uint64_t         *_offsets = _empty.offsets;
+    const std::uint64_t         *_hashes  = nullptr;
+    const value_type            *_entries = nullptr;
+
+    hasher                       _hash_function;
+    key_equal                    _key_eq;
+
+    /*** Private helpers ***/
+    std::uint64_t bucket(std::uint64_t hash) const {
+        return (hash * 0x9E3779B97F4A7C15ull) >> _header->bucket_shift;
+    }
+
+    static constexpr std::uint64_t alignUp(std::uint64_t n, std::uint64_t a) {
+        return (n + a - 1) / a * a;
+    }
+
+    void attach(const std::byte *blob) {
+        _header  = reinterpret_cast<const frozen_map_header*>(blob);
+        _offsets = reinterpret_cast<const std::uint64_t*>(blob + _header->offsets_at);
+        _hashes  = reinterpret_cast<const std::uint64_t*>(blob + _header->hashes_at);
+        _entries = reinterpret_cast<const value_type*>(blob + _header->entries_at);
+    }
+
+    static bool validLayout(const std::byte *blob, size_type bytes);
+
+    void build(std::vector<value_type> items, std::vector<std::uint64_t> hashes);
+};
+
+template <typename Key, typename T, typename Hash, typename KeyEqual>
+inline constexpr typename frozen_map<Key, T, Hash, KeyEqual>::empty_blob frozen_map<Key, T, Hash, KeyEqual>::_empty = {
+    {
+        {'M', 'Y', 'F', 'R', 'O', 'Z', 'E', 'N'},
+        frozen_map_version,
+        sizeof(Key),
+        sizeof(T),
+        63,                                                    // bucket_shift
+        0,                                                     // size
+        2,                                                     // bucket_count
+        offsetof(empty_blob, offsets),                         // offsets_at
+        sizeof(empty_blob),                                    // hashes_at
+        sizeof(empty_blob),                                    // entries_at
+        sizeof(empty_blob),                                    // total_bytes
+    },
+    {0, 0, 0},
+};
+
+template <typename Key, typename T, typename Hash, typename KeyEqual>
+template <class InputIt>
+frozen_map<Key, T, Hash, KeyEqual>::frozen_map(InputIt first, InputIt last,
+                                               const Hash &hash,
+                                               const key_equal &equal)
+: _hash_function(hash), _key_eq(equal)
+{
+    std::vector<value_type> items;
+    std::vector<std::uint64_t> hashes;
+
+    for (; first != last; ++first) {
+        items.push_back({first->first, first->second});
+        hashes.push_back(_hash_function(first->first));
+    }
+
+    build(std::move(items), std::move(hashes));
+}
+
+template <typename Key, typename T, typename Hash, typename KeyEqual>
+template <class H, class E, class A>
+frozen_map<Key, T, Hash, KeyEqual>::frozen_map(const unordered_map<Key, T, H, E, A> &map,
+                                               const Hash &hash,
+                                               const key_equal &equal)
+: _hash_function(hash), _key_eq(equal)
+{
+    std::vector<value_type> items;
+    std::vector<std::uint64_t> hashes;
+    items.reserve(map.size());
+    hashes.reserve(map.size());
+
+    for (const auto &kv : map) {
+        items.push_back({kv.first, kv.second});
+        hashes.push_back(_hash_function(kv.first));
+    }
+
+    build(std::move(items), std::move(hashes));
+}
+
+// Counting sort by bucket: count, prefix sum, scatter, then copy each bucket
+// into the blob skipping keys already written to it
+template <typename Key, typename T, typename Hash, typename KeyEqual>
+void frozen_map<Key, T, Hash, KeyEqual>::build(std::vector<value_type> items,
+                                               std::vector<std::uint64_t> hashes)
+{
+    const std::uint64_t n = items.size();
+
+    // At least 2 buckets so the shift below stays under 64
+    std::uint32_t log2Buckets = 1;
+    while ((std::uint64_t{1} << log2Buckets) < n)
+        ++log2Buckets;
+
+    const std::uint64_t bucketCount = std::uint64_t{1} << log2Buckets;
+    const std::uint32_t shift = 64 - log2Buckets;
+    auto bucketOf = [shift](std::uint64_t h) -> std::uint64_t {
+        return (h * 0x9E3779B97F4A7C15ull) >> shift;
+    };
+
+    std::vector<std::uint64_t> start(bucketCount + 1, 0);
+    for (auto h : hashes)
+        ++start[bucketOf(h) + 1];
+    for (std::uint64_t b = 0; b < bucketCount; ++b)
+        start[b + 1] += start[b];
+
+    std::vector<std::uint64_t> order(n);
+    {
+        std::vector<std::uint64_t> cursor(start.begin(), start.end() - 1);
+        for (std::uint64_t i = 0; i < n; ++i)
+            order[cursor[bucketOf(hashes[i])]++] = i;
+    }
+
+    std::vector<std::uint64_t> offsets(bucketCount + 1, 0);
+    std::vector<std::uint64_t> outHashes;
+    std::vector<value_type> outItems;
+    outHashes.reserve(n);
+    outItems.reserve(n);
+
+    for (std::uint64_t b = 0; b < bucketCount; ++b) {
+        offsets[b] = outItems.size();
+
+        for (auto j = start[b]; j < start[b + 1]; ++j) {
+            const auto i = order[j];
+            bool duplicate = false;
+
+            for (auto k = offsets[b]; k < outItems.size() && !duplicate; ++k)
+                duplicate = outHashes[k] == hashes[i] && _key_eq(outItems[k].first, items[i].first);
+
+            if (!duplicate) {
+                outHashes.push_back(hashes[i]);
+                outItems.push_back(items[i]);
+            }
+        }
+    }
+    offsets[bucketCount] = outItems.size();
+
+    frozen_map_header header{};
+    std::memcpy(header.magic, frozen_map_magic, sizeof(header.magic));
+    header.version      = frozen_map_version;
+    header.key_size     = sizeof(Key);
+    header.value_size   = sizeof(T);
+    header.bucket_shift = shift;
+    header.size         = outItems.size();
+    header.bucket_count = bucketCount;
+    header.offsets_at   = alignUp(sizeof(frozen_map_header), alignof(std::uint64_t));
+    header.hashes_at    = header.offsets_at + (bucketCount + 1) * sizeof(std::uint64_t);
+    header.entries_at   = alignUp(header.hashes_at + header.size * sizeof(std::uint64_t),
+                                  std::max(alignof(value_type), alignof(std::uint64_t)));
+    header.total_bytes  = header.entries_at + header.size * sizeof(value_type);
+
+    // Zeroed, and the padding inside each entry (Key's and T's own included)
+    // cleared after the copy, so saved files are deterministic and don't
+    // carry whatever was on the heap
+    _owned = std::make_unique<std::byte[]>(header.total_bytes);
+    auto *blob = _owned.get();
+    std::memset(blob, 0, header.total_bytes);
+
+    std::memcpy(blob, &header, sizeof(header));
+    std::memcpy(blob + header.offsets_at, offsets.data(), offsets.size() * sizeof(std::uint64_t));
+    if (header.size) {
+        std::memcpy(blob + header.hashes_at, outHashes.data(), outHashes.size() * sizeof(std::uint64_t));
+
+        auto *entries = reinterpret_cast<value_type*>(blob + header.entries_at);
+        std::memcpy(entries, outItems.data(), outItems.size() * sizeof(value_type));
+#if __has_builtin(__builtin_clear_padding)
+        if constexpr (!std::has_unique_object_representations_v<value_type>)
+            for (std::uint64_t i = 0; i < header.size; ++i)
+                __builtin_clear_padding(entries + i);
+#endif
+    }
+
+    attach(blob);
+}
+
+/*** Persistence ***/
+// Everything find() follows has to stay inside the mapping: each section in
+// bounds and aligned, the shift matching the bucket count, and the offsets
+// never decreasing up to size (one pass over them, so open() is O(buckets))
+template <typename Key, typename T, typename Hash, typename KeyEqual>
+bool frozen_map<Key, T, Hash, KeyEqual>::validLayout(const std::byte *blob, size_type bytes) {
+    const auto &h = *reinterpret_cast<const frozen_map_header*>(blob);
+    constexpr std::uint64_t word = sizeof(std::uint64_t);
+    constexpr std::uint64_t entryAlign = std::max(alignof(value_type), alignof(std::uint64_t));
+
+    if (h.bucket_count < 2 || !std::has_single_bit(h.bucket_count)
+        || h.bucket_shift != static_cast<std::uint32_t>(64 - std::countr_zero(h.bucket_count)))
+        return false;
+
+    // Divisions rather than multiplications so huge counts can't wrap
+    if (h.offsets_at < sizeof(frozen_map_header) || h.offsets_at % word
+        || h.offsets_at > bytes || (bytes - h.offsets_at) / word < h.bucket_count + 1)
+        return false;
+    if (h.hashes_at < h.offsets_at + (h.bucket_count + 1) * word || h.hashes_at % word
+        || h.hashes_at > bytes || (bytes - h.hashes_at) / word < h.size)
+        return false;
+    if (h.entries_at < h.hashes_at + h.size * word || h.entries_at % entryAlign
+        || h.entries_at > bytes || (bytes - h.entries_at) / sizeof(value_type) < h.size)
+        return false;
+
+    const auto *offsets = reinterpret_cast<const std::uint64_t*>(blob + h.offsets_at);
+    if (offsets[0] != 0 || offsets[h.bucket_count] != h.size)
+        return false;
+    for (std::uint64_t b = 0; b < h.bucket_count; ++b)
+        if (offsets[b] > offsets[b + 1])
+            return false;
+
+    return true;
+}
+
+template <typename Key, typename T, typename Hash, typename KeyEqual>
+void frozen_map<Key, T, Hash, KeyEqual>::save(const std::string &path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(_header), _header->total_bytes);
+
+    if (!out)
+        throw(std::runtime_error("frozen_map: failed to write " + path));
+}
+
+template <typename Key, typename T, typename Hash, typename KeyEqual>
+frozen_map<Key, T, Hash, KeyEqual>
+frozen_map<Key, T, Hash, KeyEqual>::open(const std::string &path,
+                                         const Hash &hash,
+                                         const key_equal &equal)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw(std::runtime_error("frozen_map: can't open " + path));
+
+    struct stat st{};
+    if (::fstat(fd, &st) < 0 || static_cast<size_type>(st.st_size) < sizeof(frozen_map_header)) {
+        ::close(fd);
+        throw(std::runtime_error("frozen_map: " + path + " is too small"));
+    }
+
+    const auto bytes = static_cast<size_type>(st.st_size);
+    void *mem = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (mem == MAP_FAILED)
+        throw(std::runtime_error("frozen_map: mmap failed for " + path));
+
+    frozen_map out(hash, equal);
+    out._owned.reset();
+    out._mapped = mem;
+    out._mapped_bytes = bytes;
+
+    const auto *header = static_cast<const frozen_map_header*>(mem);
+    if (std::memcmp(header->magic, frozen_map_magic, sizeof(header->magic))
+        || header->version != frozen_map_version
+        || header->key_size != sizeof(Key)
+        || header->value_size != sizeof(T)
+        || header->total_bytes != bytes)
+        throw(std::runtime_error("frozen_map: " + path + " doesn't hold this map type"));
+
+    if (!validLayout(static_cast<const std::byte*>(mem), bytes))
+        throw(std::runtime_error("frozen_map: " + path + " is corrupted"));
+
+    out.attach(static_cast<const std::byte*>(mem));
+    return out;
+}
+
+} // namespace My
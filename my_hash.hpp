@@ -0,0 +1,145 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+namespace My {
+
+/*
+ * Hashers for My:: containers, not defined in STL
+ * libstdc++'s std::hash is the identity for integers (sequential ids all land
+ * in sequential buckets and any power of two stride collides) and walks
+ * strings a byte at a time. These are drop in replacements:
+ *  - integers/enums/pointers go through a multiply-xorshift finalizer
+ *  - strings use wyhash (https://github.com/wangyi-fudan/wyhash), which eats
+ *    48 bytes per step in 3 independent lanes of 64x64->128 bit multiplies
+ *  - anything else falls back to std::hash
+ *
+ * Both are seeded with constants so a key hashes the same in every process,
+ * which frozen_map relies on when it's saved to disk.
+ */
+
+namespace hash_detail {
+
+// The splitmix64 finalizer, every input bit affects every output bit
+constexpr std::uint64_t mix64(std::uint64_t x) noexcept {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+constexpr std::uint64_t wysecret[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+    0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+};
+
+inline void wymum(std::uint64_t &a, std::uint64_t &b) noexcept {
+    const __uint128_t r = static_cast<__uint128_t>(a) * b;
+    a = static_cast<std::uint64_t>(r);
+    b = static_cast<std::uint64_t>(r >> 64);
+}
+
+inline std::uint64_t wymix(std::uint64_t a, std::uint64_t b) noexcept {
+    wymum(a, b);
+    return a ^ b;
+}
+
+// Unaligned little endian loads, memcpy compiles down to a single mov
+inline std::uint64_t read8(const unsigned char *p) noexcept {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline std::uint64_t read4(const unsigned char *p) noexcept {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// 1 to 3 bytes, reads the first, middle and last byte so nothing branches on len
+inline std::uint64_t read3(const unsigned char *p, std::size_t len) noexcept {
+    return (std::uint64_t{p[0]} << 16) | (std::uint64_t{p[len >> 1]} << 8) | p[len - 1];
+}
+
+inline std::uint64_t wyhash(const void *key, std::size_t len, std::uint64_t seed = 0) noexcept {
+    const auto *p = static_cast<const unsigned char*>(key);
+    seed ^= wymix(seed ^ wysecret[0], wysecret[1]);
+
+    std::uint64_t a, b;
+    if (len <= 16) [[likely]] {
+        if (len >= 4) {
+            // Two overlapping 4 byte reads from each end cover 4..16 bytes
+            const std::size_t mid = (len >> 3) << 2;
+            a = (read4(p) << 32) | read4(p + mid);
+            b = (read4(p + len - 4) << 32) | read4(p + len - 4 - mid);
+        } else if (len > 0) {
+            a = read3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        std::size_t i = len;
+
+        if (i >= 48) [[unlikely]] {
+            std::uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wymix(read8(p)      ^ wysecret[1], read8(p + 8)  ^ seed);
+                see1 = wymix(read8(p + 16) ^ wysecret[2], read8(p + 24) ^ see1);
+                see2 = wymix(read8(p + 32) ^ wysecret[3], read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+
+        while (i > 16) [[unlikely]] {
+            seed = wymix(read8(p) ^ wysecret[1], read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+
+        // The last 16 bytes, overlapping with what was already mixed
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+
+    a ^= wysecret[1];
+    b ^= seed;
+    wymum(a, b);
+    return wymix(a ^ wysecret[0] ^ len, b ^ wysecret[1]);
+}
+
+} // namespace hash_detail
+
+template <class T>
+struct hash : std::hash<T> {};
+
+template <class T>
+requires (std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>)
+struct hash<T> {
+    std::size_t operator()(T x) const noexcept {
+        if constexpr (std::is_pointer_v<T>)
+            return hash_detail::mix64(reinterpret_cast<std::uintptr_t>(x));
+        else
+            return hash_detail::mix64(static_cast<std::uint64_t>(x));
+    }
+};
+
+// Transparent so a map keyed on std::string can be searched with string_view
+// or a literal without building a std::string (pair it with std::equal_to<>)
+struct string_hash {
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view s) const noexcept {
+        return hash_detail::wyhash(s.data(), s.size());
+    }
+};
+
+template <> struct hash<std::string> : string_hash {};
+template <> struct hash<std::string_view> : string_hash {};
+
+} // namespace My
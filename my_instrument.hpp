@@ -0,0 +1,251 @@
+#pragma once
+
+#include <bits/stdc++.h>
+#include <cxxabi.h>
+
+namespace My {
+
+/*
+ * Allocation and copy counters for the My:: containers, not defined in STL
+ * Only there when built with -DMY_INSTRUMENT (make instrument), otherwise
+ * every hook below is a no-op and the containers use std::allocator_traits
+ * directly, so a normal build doesn't pay a single instruction for this.
+ *
+ * Counters are per container value_type (the element of a vector, the pair
+ * of a map) and cover
+ *
+ *   allocations/deallocations/bytes    every allocate() the container makes
+ *   copies/moves                       elements copy/move constructed
+ *   relocations                        elements moved by memcpy/memmove
+ *   reallocations                      vector grows, map rehashes
+ *
+ * The point is catching regressions (an accidental copy, a missing reserve)
+ * in a benchmark run:
+ *
+ *   My::instrument::scope s("load book");         // prints the deltas when done
+ *   ...
+ *   assert(s.delta<order>().copies == 0);
+ *
+ * NOTE: counters are relaxed atomics, shared by every thread
+ */
+
+#ifdef MY_INSTRUMENT
+inline constexpr bool instrumented = true;
+#else
+inline constexpr bool instrumented = false;
+#endif
+
+namespace instrument {
+
+enum class counter : std::size_t {
+    allocations, deallocations, bytes, copies, moves, relocations, reallocations, count_
+};
+
+// Snapshot of one type's counters
+struct counts {
+    std::size_t allocations   = 0;
+    std::size_t deallocations = 0;
+    std::size_t bytes         = 0;
+    std::size_t copies        = 0;
+    std::size_t moves         = 0;
+    std::size_t relocations   = 0;
+    std::size_t reallocations = 0;
+
+    bool empty() const noexcept { return *this == counts{}; }
+
+    friend bool operator==(const counts&, const counts&) = default;
+
+    friend counts operator-(counts a, const counts &b) noexcept {
+        a.allocations   -= b.allocations;
+        a.deallocations -= b.deallocations;
+        a.bytes         -= b.bytes;
+        a.copies        -= b.copies;
+        a.moves         -= b.moves;
+        a.relocations   -= b.relocations;
+        a.reallocations -= b.reallocations;
+        return a;
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const counts &c) {
+        return os << "allocs " << c.allocations << " frees " << c.deallocations
+                  << " bytes " << c.bytes << " copies " << c.copies << " moves " << c.moves
+                  << " relocated " << c.relocations << " reallocs " << c.reallocations;
+    }
+};
+
+namespace detail {
+
+struct live_counts {
+    std::array<std::atomic<std::size_t>, std::size_t(counter::count_)> values{};
+
+    counts snapshot() const noexcept {
+        auto get = [this](counter c) { return values[std::size_t(c)].load(std::memory_order_relaxed); };
+        return {get(counter::allocations), get(counter::deallocations), get(counter::bytes),
+                get(counter::copies), get(counter::moves), get(counter::relocations),
+                get(counter::reallocations)};
+    }
+};
+
+struct entry {
+    std::string  name;
+    live_counts *live;
+};
+
+// Every type that counted something, in first use order
+inline std::mutex &registryMutex() {
+    static std::mutex m;
+    return m;
+}
+
+inline std::vector<entry> &registry() {
+    static std::vector<entry> types;
+    return types;
+}
+
+template <class T>
+std::string typeName() {
+    int status = 0;
+    std::unique_ptr<char, void(*)(void*)> name(
+        abi::__cxa_demangle(typeid(T).name(), nullptr, nullptr, &status), std::free);
+    return status == 0 ? name.get() : typeid(T).name();
+}
+
+template <class T>
+live_counts &liveFor() {
+    static live_counts *live = [] {
+        auto *out = new live_counts;   // never freed, counters outlive static destructors
+        std::lock_guard<std::mutex> lock(registryMutex());
+        registry().push_back({typeName<T>(), out});
+        return out;
+    }();
+    return *live;
+}
+
+} // namespace detail
+
+template <class T>
+void add(counter c, std::size_t n = 1) noexcept {
+    detail::liveFor<T>().values[std::size_t(c)].fetch_add(n, std::memory_order_relaxed);
+}
+
+template <class T>
+counts counts_for() { return detail::liveFor<T>().snapshot(); }
+
+// Every type seen so far with its counters
+inline std::vector<std::pair<std::string, counts>> all_counts() {
+    std::lock_guard<std::mutex> lock(detail::registryMutex());
+    std::vector<std::pair<std::string, counts>> out;
+    for (const auto &e : detail::registry())
+        out.emplace_back(e.name, e.live->snapshot());
+    return out;
+}
+
+/*
+ * Counts what happened while it was alive and, unless out is null, prints
+ * one line per type that did something when it goes out of scope
+ */
+class scope {
+public:
+    explicit scope(std::string label = "", std::ostream *out = &std::cerr)
+    : _label(std::move(label)), _out(out), _start(all_counts()) {}
+
+    scope(const scope&) = delete;
+    scope &operator=(const scope&) = delete;
+
+    ~scope() {
+        if (!_out || !instrumented)
+            return;
+
+        for (const auto &[name, c] : deltas())
+            *_out << "[instrument] " << _label << (_label.empty() ? "" : ": ")
+                  << name << ": " << c << '\n';
+    }
+
+    template <class T>
+    counts delta() const {
+        const std::string name = detail::typeName<T>();
+        const counts now = counts_for<T>();
+        for (const auto &[n, c] : _start)
+            if (n == name)
+                return now - c;
+        return now;
+    }
+
+    // Types whose counters moved since the scope started
+    std::vector<std::pair<std::string, counts>> deltas() const {
+        std::vector<std::pair<std::string, counts>> out;
+        for (auto &[name, c] : all_counts()) {
+            auto it = std::find_if(_start.begin(), _start.end(),
+                                   [&](const auto &s) { return s.first == name; });
+            const counts d = it == _start.end() ? c : c - it->second;
+            if (!d.empty())
+                out.emplace_back(name, d);
+        }
+        return out;
+    }
+
+private:
+    std::string                                   _label;
+    std::ostream                                 *_out;
+    std::vector<std::pair<std::string, counts>>   _start;
+};
+
+/*
+ * std::allocator_traits that counts, Tag picks the counters (the container's
+ * value_type, so node and bucket allocations land on the map's pair)
+ * A single argument construct() of the element type is a copy or a move,
+ * anything else is an emplace and isn't counted
+ */
+template <class Alloc, class Tag>
+struct counting_traits : std::allocator_traits<Alloc> {
+    using base = std::allocator_traits<Alloc>;
+
+    template <class U>
+    using rebind_traits = counting_traits<typename base::template rebind_alloc<U>, Tag>;
+
+    [[nodiscard]] static auto allocate(Alloc &alloc, typename base::size_type n) {
+        if (n) {
+            add<Tag>(counter::allocations);
+            add<Tag>(counter::bytes, n * sizeof(typename base::value_type));
+        }
+        return base::allocate(alloc, n);
+    }
+
+    static void deallocate(Alloc &alloc, typename base::pointer p, typename base::size_type n) {
+        if (p)
+            add<Tag>(counter::deallocations);
+        base::deallocate(alloc, p, n);
+    }
+
+    template <class U, class... Args>
+    static void construct(Alloc &alloc, U *p, Args&&... args) {
+        if constexpr (sizeof...(Args) == 1) {
+            using arg = std::tuple_element_t<0, std::tuple<Args...>>;
+            if constexpr (std::is_same_v<std::remove_cvref_t<arg>, std::remove_cv_t<U>>)
+                add<Tag>(std::is_lvalue_reference_v<arg> || std::is_const_v<std::remove_reference_t<arg>>
+                         ? counter::copies : counter::moves);
+        }
+        base::construct(alloc, p, std::forward<Args>(args)...);
+    }
+};
+
+// What the containers use in place of std::allocator_traits
+#ifdef MY_INSTRUMENT
+template <class Alloc, class Tag = typename std::allocator_traits<Alloc>::value_type>
+using traits_for = counting_traits<Alloc, Tag>;
+#else
+template <class Alloc, class Tag = typename std::allocator_traits<Alloc>::value_type>
+using traits_for = std::allocator_traits<Alloc>;
+#endif
+
+} // namespace instrument
+
+} // namespace My
+
+// Bumps a counter for the code paths that don't go through the traits
+// (memcpy relocation, SIMD copies, grows), nothing at all by default
+#ifdef MY_INSTRUMENT
+#define MY_INSTRUMENT_ADD(Tag, which, n) ::My::instrument::add<Tag>(::My::instrument::counter::which, (n))
+#else
+#define MY_INSTRUMENT_ADD(Tag, which, n) static_cast<void>(0)
+#endif
@@ -0,0 +1,370 @@
+#pragma once
+
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace My {
+
+/*
+ * Vector living in a memory mapped file, not defined in STL
+ * The file is a small header followed by the elements, exactly as they sit
+ * in memory:
+ *
+ *   mapped_vector_header   magic, version, sizeof/alignof(T), size, capacity
+ *   padding up to 64 bytes
+ *   T[capacity]            the first size are live
+ *
+ * so a dataset written once can be reopened by any later process with no
+ * parsing or copying, the pages come in from the page cache as they're used.
+ * Appending works like My::vector: past capacity the file is grown
+ * geometrically with ftruncate and remapped with mremap. The slack past
+ * size() is a hole in the file, it takes no disk space.
+ *
+ *   auto ticks = My::mapped_vector<tick>::create("ticks.bin");
+ *   ticks.push_back(t);                            // written through the mapping
+ *
+ *   auto replay = My::mapped_vector<tick>::open("ticks.bin", false);
+ *   for (const tick &t : replay) ...
+ *
+ * NOTE: one writer at a time, and a reader only sees appends made before it
+ *       opened the file. Data reaches the disk whenever the kernel writes the
+ *       pages back, flush() forces it
+ */
+
+constexpr std::uint32_t mapped_vector_version = 1;
+constexpr char mapped_vector_magic[8] = {'M', 'Y', 'M', 'A', 'P', 'V', 'E', 'C'};
+
+// Elements start at this offset, so T can be aligned up to it
+constexpr std::uint64_t mapped_vector_data_at = 64;
+
+struct mapped_vector_header {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t value_size;
+    std::uint32_t value_align;
+    std::uint32_t reserved;
+    std::uint64_t size;
+    std::uint64_t capacity;
+    std::uint64_t data_at;
+};
+
+template <typename T>
+class mapped_vector {
+public:
+    using value_type      = T;
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference       = value_type&;
+    using const_reference = const value_type&;
+    using pointer         = value_type*;
+    using const_pointer   = const value_type*;
+    using iterator        = pointer;
+    using const_iterator  = const_pointer;
+
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "mapped_vector stores raw bytes, T must be trivially copyable");
+    static_assert(alignof(T) <= mapped_vector_data_at,
+                  "mapped_vector elements can't be aligned past the header");
+
+
+    /*** Constructors and Destructors***/
+    // Creates (or truncates) path with room for capacity elements
+    static mapped_vector create(const std::string &path, size_type capacity = 0);
+
+    // Maps an existing file, read only unless writable
+    static mapped_vector open(const std::string &path, bool writable = true);
+
+    mapped_vector(mapped_vector &&other) noexcept { swap(other); }
+    mapped_vector &operator=(mapped_vector &&other) noexcept {
+        mapped_vector temp(std::move(other));
+        swap(temp);
+        return *this;
+    }
+
+    mapped_vector(const mapped_vector &) = delete;
+    mapped_vector &operator=(const mapped_vector &) = delete;
+
+    ~mapped_vector() {
+        if (_map)
+            ::munmap(_map, _map_bytes);
+        if (_fd >= 0)
+            ::close(_fd);
+    }
+
+    void swap(mapped_vector &other) noexcept {
+        std::swap(_fd, other._fd);
+        std::swap(_map, other._map);
+        std::swap(_map_bytes, other._map_bytes);
+        std::swap(_writable, other._writable);
+        std::swap(_path, other._path);
+    }
+
+    /*** Element access ***/
+    reference at(size_type pos) {
+        if (pos >= size())
+            throw(std::out_of_range("Index out of range"));
+        return data()[pos];
+    }
+    const_reference at(size_type pos) const {
+        if (pos >= size())
+            throw(std::out_of_range("Index out of range"));
+        return data()[pos];
+    }
+
+    reference operator[](size_type pos) { return data()[pos]; }
+    const_reference operator[](size_type pos) const { return data()[pos]; }
+
+    reference front() { return data()[0]; }
+    const_reference front() const { return data()[0]; }
+
+    reference back() { return data()[size() - 1]; }
+    const_reference back() const { return data()[size() - 1]; }
+
+    // NOTE: writing through these on a read only mapping is a segfault
+    pointer data() noexcept { return reinterpret_cast<pointer>(_map + mapped_vector_data_at); }
+    const_pointer data() const noexcept { return reinterpret_cast<const_pointer>(_map + mapped_vector_data_at); }
+
+    /*** Iterators ***/
+    iterator begin() noexcept { return data(); }
+    const_iterator begin() const noexcept { return data(); }
+    const_iterator cbegin() const noexcept { return data(); }
+
+    iterator end() noexcept { return data() + size(); }
+    const_iterator end() const noexcept { return data() + size(); }
+    const_iterator cend() const noexcept { return data() + size(); }
+
+    /*** Capacity ***/
+    bool empty() const noexcept { return !size(); }
+    size_type size() const noexcept { return header()->size; }
+    size_type capacity() const noexcept { return header()->capacity; }
+
+    void reserve(size_type newCap) {
+        if (newCap > capacity())
+            remap(newCap);
+    }
+
+    // Cuts the file down to size() elements
+    void shrink_to_fit() {
+        if (capacity() > size())
+            remap(size());
+    }
+
+    /*** Modifiers ***/
+    void clear() { setSize(0); }
+
+    void push_back(const_reference value) { emplace_back(value); }
+
+    // The element is built before a grow can move the mapping, so
+    // v.push_back(v[0]) is fine
+    template <class... Args>
+    reference emplace_back(Args&&... args) {
+        checkWritable();
+        value_type value(std::forward<Args>(args)...);
+        const size_type n = size();
+
+        if (n == capacity())
+            remap(nextCapacity(n + 1));
+
+        std::memcpy(static_cast<void*>(data() + n), &value, sizeof(T));
+        setSize(n + 1);
+        return data()[n];
+    }
+
+    void pop_back() { setSize(size() - 1); }
+
+    // One grow and one memcpy for contiguous ranges of T
+    template <class R>
+    void append_range(R &&rg) {
+        using source = std::remove_cvref_t<std::ranges::range_reference_t<R>>;
+
+        if constexpr (std::ranges::contiguous_range<R> && std::ranges::sized_range<R>
+                      && std::is_same_v<source, T>) {
+            const size_type count = std::ranges::size(rg);
+            std::span<T> tail = append_uninitialized(count);
+            if (count)
+                std::memcpy(static_cast<void*>(tail.data()), std::ranges::data(rg), count * sizeof(T));
+        } else {
+            for (auto &&x : rg)
+                emplace_back(std::forward<decltype(x)>(x));
+        }
+    }
+
+    // Same as My::vector's, the new elements hold whatever the file held
+    // (zeros for a fresh file)
+    std::span<value_type> append_uninitialized(size_type count) {
+        checkWritable();
+        const size_type n = size();
+        if (n + count > capacity())
+            remap(nextCapacity(n + count));
+
+        setSize(n + count);
+        return std::span<value_type>(data() + n, count);
+    }
+
+    void resize(size_type count) { resize(count, value_type()); }
+    void resize(size_type count, const_reference value) {
+        checkWritable();
+        const size_type n = size();
+        if (count <= n) {
+            setSize(count);
+            return;
+        }
+
+        const value_type copy(value);
+        std::span<value_type> tail = append_uninitialized(count - n);
+        std::fill(tail.begin(), tail.end(), copy);
+    }
+
+    // Blocks until every dirty page is on disk
+    void flush() {
+        if (_writable && ::msync(_map, _map_bytes, MS_SYNC) < 0)
+            throw(std::runtime_error("mapped_vector: msync failed for " + _path));
+    }
+
+    /*** Other ***/
+    bool writable() const noexcept { return _writable; }
+    const std::string& path() const noexcept { return _path; }
+
+    // Size of the file, header and spare capacity included
+    size_type bytes() const noexcept { return _map_bytes; }
+
+private:
+    int          _fd        = -1;
+    std::byte   *_map       = nullptr;
+    size_type    _map_bytes = 0;
+    bool         _writable  = false;
+    std::string  _path;
+
+    mapped_vector() = default;
+
+    mapped_vector_header* header() noexcept { return reinterpret_cast<mapped_vector_header*>(_map); }
+    const mapped_vector_header* header() const noexcept {
+        return reinterpret_cast<const mapped_vector_header*>(_map);
+    }
+
+    static size_type bytesFor(size_type capacity) noexcept {
+        return mapped_vector_data_at + capacity * sizeof(T);
+    }
+
+    size_type nextCapacity(size_type needed) const noexcept {
+        return std::max(needed, capacity() * 2);
+    }
+
+    void checkWritable() const {
+        if (!_writable)
+            throw(std::runtime_error("mapped_vector: " + _path + " is open read only"));
+    }
+
+    void setSize(size_type count) {
+        checkWritable();
+        header()->size = count;
+    }
+
+    // Resizes the file, then the mapping (which may move)
+    void remap(size_type newCap) {
+        checkWritable();
+
+        const size_type bytes = bytesFor(newCap);
+        if (::ftruncate(_fd, static_cast<off_t>(bytes)) < 0)
+            throw(std::runtime_error("mapped_vector: can't resize " + _path));
+
+        void *mem = ::mremap(_map, _map_bytes, bytes, MREMAP_MAYMOVE);
+        if (mem == MAP_FAILED)
+            throw(std::runtime_error("mapped_vector: mremap failed for " + _path));
+
+        _map = static_cast<std::byte*>(mem);
+        _map_bytes = bytes;
+        header()->capacity = newCap;
+    }
+
+    void mapFile(int fd, size_type bytes, bool writable);
+};
+
+/*** Persistence ***/
+template <typename T>
+void mapped_vector<T>::mapFile(int fd, size_type bytes, bool writable)
+{
+    _fd = fd;
+    _writable = writable;
+
+    const int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *mem = ::mmap(nullptr, bytes, prot, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED)
+        throw(std::runtime_error("mapped_vector: mmap failed for " + _path));
+
+    _map = static_cast<std::byte*>(mem);
+    _map_bytes = bytes;
+}
+
+template <typename T>
+mapped_vector<T> mapped_vector<T>::create(const std::string &path, size_type capacity)
+{
+    mapped_vector out;
+    out._path = path;
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw(std::runtime_error("mapped_vector: can't create " + path));
+
+    const size_type bytes = bytesFor(capacity);
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) < 0) {
+        ::close(fd);
+        throw(std::runtime_error("mapped_vector: can't resize " + path));
+    }
+
+    out.mapFile(fd, bytes, true);
+
+    mapped_vector_header header{};
+    std::memcpy(header.magic, mapped_vector_magic, sizeof(header.magic));
+    header.version     = mapped_vector_version;
+    header.value_size  = sizeof(T);
+    header.value_align = alignof(T);
+    header.size        = 0;
+    header.capacity    = capacity;
+    header.data_at     = mapped_vector_data_at;
+    std::memcpy(out._map, &header, sizeof(header));
+
+    return out;
+}
+
+template <typename T>
+mapped_vector<T> mapped_vector<T>::open(const std::string &path, bool writable)
+{
+    mapped_vector out;
+    out._path = path;
+
+    const int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0)
+        throw(std::runtime_error("mapped_vector: can't open " + path));
+
+    struct stat st{};
+    if (::fstat(fd, &st) < 0 || static_cast<size_type>(st.st_size) < mapped_vector_data_at) {
+        ::close(fd);
+        throw(std::runtime_error("mapped_vector: " + path + " is too small"));
+    }
+
+    const auto bytes = static_cast<size_type>(st.st_size);
+    out.mapFile(fd, bytes, writable);
+
+    const auto *header = out.header();
+    if (std::memcmp(header->magic, mapped_vector_magic, sizeof(header->magic))
+        || header->version != mapped_vector_version
+        || header->value_size != sizeof(T)
+        || header->value_align != alignof(T)
+        || header->data_at != mapped_vector_data_at
+        || header->size > header->capacity
+        || header->capacity > (bytes - mapped_vector_data_at) / sizeof(T))
+        throw(std::runtime_error("mapped_vector: " + path + " doesn't hold this vector type"));
+
+    return out;
+}
+
+template <typename T>
+void swap(mapped_vector<T> &lhs, mapped_vector<T> &rhs) noexcept {
+    lhs.swap(rhs);
+}
+
+} // namespace My
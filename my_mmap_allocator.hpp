@@ -0,0 +1,129 @@
+#pragma once
+
+#include <bits/stdc++.h>
+#include <sys/mman.h>
+
+#include "my_vector.hpp"
+
+namespace My {
+
+/*
+ * Allocator for very large buffers, not defined in STL
+ * Small blocks come from operator new like std::allocator. Blocks of
+ * Threshold bytes or more are their own anonymous mapping:
+ *  - the mapping is 2MB aligned and madvise'd MADV_HUGEPAGE, so with
+ *    transparent huge pages on (enabled=madvise or always) a multi GB buffer
+ *    is a few thousand TLB entries instead of a million
+ *  - pages are only backed once touched, so reserving ahead costs no RSS
+ *  - reallocate() grows a mapping with mremap, which moves page table
+ *    entries instead of bytes. My::vector uses it for relocatable types so a
+ *    grow never holds two copies of the data and never copies it
+ *
+ * NOTE: mremap may move the mapping to an address that isn't 2MB aligned,
+ *       the kernel then only uses huge pages for the aligned part of it
+ */
+
+template <class T, std::size_t Threshold = std::size_t{2} << 20>
+class mmap_allocator {
+public:
+    using value_type      = T;
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    // Stateless, any instance can free any block
+    using propagate_on_container_move_assignment = std::true_type;
+    using is_always_equal                        = std::true_type;
+
+    template <class U>
+    struct rebind {
+        using other = mmap_allocator<U, Threshold>;
+    };
+
+    static constexpr std::size_t huge_page_size = std::size_t{2} << 20;
+
+    mmap_allocator() = default;
+    template <class U>
+    mmap_allocator(const mmap_allocator<U, Threshold>&) noexcept {}
+
+    T* allocate(size_type n) {
+        if (n > std::numeric_limits<size_type>::max() / sizeof(T))
+            throw(std::bad_array_new_length());
+
+        const std::size_t bytes = n * sizeof(T);
+        if (!isMapped(bytes))
+            return static_cast<T*>(::operator new(bytes, std::align_val_t(alignof(T))));
+
+        return static_cast<T*>(map(mappedLength(bytes)));
+    }
+
+    void deallocate(T *p, size_type n) noexcept {
+        const std::size_t bytes = n * sizeof(T);
+        if (isMapped(bytes))
+            ::munmap(p, mappedLength(bytes));
+        else
+            ::operator delete(p, std::align_val_t(alignof(T)));
+    }
+
+    // not defined in STL
+    // Resizes a mapped block from oldN to newN elements keeping its bytes,
+    // the block may move. Returns nullptr (and p stays valid) if either size
+    // is under the threshold or the kernel says no, the caller then does a
+    // regular allocate + copy
+    T* reallocate(T *p, size_type oldN, size_type newN) noexcept {
+        if (newN > std::numeric_limits<size_type>::max() / sizeof(T))
+            return nullptr;
+
+        const std::size_t oldBytes = oldN * sizeof(T), newBytes = newN * sizeof(T);
+        if (!isMapped(oldBytes) || !isMapped(newBytes))
+            return nullptr;
+
+        const std::size_t oldLen = mappedLength(oldBytes), newLen = mappedLength(newBytes);
+        if (oldLen == newLen)
+            return p;
+
+        void *mem = ::mremap(p, oldLen, newLen, MREMAP_MAYMOVE);
+        if (mem == MAP_FAILED)
+            return nullptr;
+
+        ::madvise(mem, newLen, MADV_HUGEPAGE);
+        return static_cast<T*>(mem);
+    }
+
+    friend bool operator==(const mmap_allocator&, const mmap_allocator&) noexcept { return true; }
+
+private:
+    static constexpr bool isMapped(std::size_t bytes) noexcept {
+        return bytes >= Threshold;
+    }
+
+    static constexpr std::size_t mappedLength(std::size_t bytes) noexcept {
+        return (bytes + huge_page_size - 1) & ~(huge_page_size - 1);
+    }
+
+    // mmap only promises page alignment, so map an extra 2MB and trim both
+    // ends to leave len bytes on a huge page boundary
+    static void* map(std::size_t len) {
+        void *mem = ::mmap(nullptr, len + huge_page_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED)
+            throw(std::bad_alloc());
+
+        const auto raw = reinterpret_cast<std::uintptr_t>(mem);
+        const auto aligned = (raw + huge_page_size - 1) & ~std::uintptr_t{huge_page_size - 1};
+
+        if (aligned > raw)
+            ::munmap(mem, aligned - raw);
+        if (const std::size_t tail = huge_page_size - (aligned - raw))
+            ::munmap(reinterpret_cast<void*>(aligned + len), tail);
+
+        // Only a hint, it fails harmlessly when THP is compiled out
+        ::madvise(reinterpret_cast<void*>(aligned), len, MADV_HUGEPAGE);
+        return reinterpret_cast<void*>(aligned);
+    }
+};
+
+// not defined in STL
+template <class T>
+using huge_vector = vector<T, mmap_allocator<T>>;
+
+} // namespace My
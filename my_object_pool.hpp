@@ -0,0 +1,214 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+#include "my_unique_ptr.hpp"
+
+namespace My {
+
+/*
+ * Thread local object pools behind My::unique_ptr, not defined in STL
+ * For small objects that are made and dropped all the time (one per
+ * message, order, event...) where malloc/free show up in the profile.
+ *
+ *   My::pooled_unique_ptr<order> o = My::make_pooled<order>(id, px, qty);
+ *
+ * Every thread owns a cache with one free list per size class (16 to 512
+ * bytes, powers of two). Blocks are carved out of 64KB slabs aligned to their
+ * size, and a slab's header says which cache owns it and its size class, so
+ * freeing a block is a mask to find the header and:
+ *
+ *  - same thread: push on the local free list, no atomics
+ *  - other thread: push on the owner's remote free list (lock free), the
+ *    owner takes the whole list back the next time its local one runs dry
+ *
+ * When a thread exits its cache is parked (objects it handed out may still be
+ * alive, and remote frees keep landing in it) and the next new thread adopts
+ * it, so caches, and their slabs, are bounded by the peak thread count.
+ * Slabs are never given back to the system.
+ *
+ * Types over 512 bytes or aligned past 16 fall back to plain new/delete.
+ */
+
+namespace pool_detail {
+
+inline constexpr std::size_t slab_size    = std::size_t{1} << 16;
+inline constexpr std::size_t slab_header  = 64;
+inline constexpr std::size_t min_block    = 16;
+inline constexpr std::size_t max_block    = 512;
+inline constexpr std::size_t size_classes = 6;   // 16, 32, ..., 512
+
+template <class T>
+inline constexpr bool poolable = sizeof(T) <= max_block && alignof(T) <= min_block;
+
+constexpr std::size_t classOf(std::size_t bytes) noexcept {
+    return std::bit_width(std::max(bytes, min_block) - 1) - 4;
+}
+
+constexpr std::size_t blockSize(std::size_t cls) noexcept { return min_block << cls; }
+
+struct free_block {
+    free_block *next;
+};
+
+struct thread_cache;
+
+struct slab {
+    thread_cache *owner;
+    std::size_t   size_class;
+};
+
+inline slab* slabOf(void *p) noexcept {
+    return reinterpret_cast<slab*>(reinterpret_cast<std::uintptr_t>(p) & ~(slab_size - 1));
+}
+
+struct thread_cache {
+    std::array<free_block*, size_classes>                   free{};
+    std::array<std::byte*, size_classes>                    bump{};   // uncarved part of the newest slab
+    std::array<std::byte*, size_classes>                    bump_end{};
+    alignas(64) std::array<std::atomic<free_block*>, size_classes> remote{};
+
+    void* allocate(std::size_t cls) {
+        if (free_block *b = free[cls]) [[likely]] {
+            free[cls] = b->next;
+            return b;
+        }
+
+        // Everything the other threads gave back, in one exchange
+        if (free_block *b = remote[cls].exchange(nullptr, std::memory_order_acquire)) {
+            free[cls] = b->next;
+            return b;
+        }
+
+        if (bump[cls] == bump_end[cls])
+            newSlab(cls);
+
+        void *out = bump[cls];
+        bump[cls] += blockSize(cls);
+        return out;
+    }
+
+    void deallocate(void *p, std::size_t cls) noexcept {
+        auto *b = static_cast<free_block*>(p);
+        b->next = free[cls];
+        free[cls] = b;
+    }
+
+    void remoteDeallocate(void *p, std::size_t cls) noexcept {
+        auto *b = static_cast<free_block*>(p);
+        b->next = remote[cls].load(std::memory_order_relaxed);
+        while (!remote[cls].compare_exchange_weak(b->next, b, std::memory_order_release,
+                                                  std::memory_order_relaxed)) {}
+    }
+
+    void newSlab(std::size_t cls) {
+        auto *mem = static_cast<std::byte*>(::operator new(slab_size, std::align_val_t(slab_size)));
+        ::new (static_cast<void*>(mem)) slab{this, cls};
+
+        bump[cls] = mem + slab_header;
+        bump_end[cls] = mem + slab_header + (slab_size - slab_header) / blockSize(cls) * blockSize(cls);
+    }
+};
+
+// Caches of exited threads, waiting for a new thread to adopt them. Never
+// destroyed, threads can still exit while statics are torn down
+inline std::mutex &parkedMutex() {
+    static auto *m = new std::mutex;
+    return *m;
+}
+
+inline std::vector<thread_cache*> &parked() {
+    static auto *caches = new std::vector<thread_cache*>;
+    return *caches;
+}
+
+inline thread_local thread_cache *tls_cache = nullptr;
+
+struct cache_guard {
+    ~cache_guard() {
+        std::lock_guard<std::mutex> lock(parkedMutex());
+        parked().push_back(std::exchange(tls_cache, nullptr));
+    }
+};
+
+inline thread_cache &localCache() {
+    if (!tls_cache) [[unlikely]] {
+        {
+            std::lock_guard<std::mutex> lock(parkedMutex());
+            if (!parked().empty()) {
+                tls_cache = parked().back();
+                parked().pop_back();
+            }
+        }
+        if (!tls_cache)
+            tls_cache = new thread_cache;
+
+        // Parks the cache when the thread exits
+        static thread_local cache_guard guard;
+        static_cast<void>(guard);
+    }
+    return *tls_cache;
+}
+
+inline void* allocate(std::size_t bytes) {
+    return localCache().allocate(classOf(bytes));
+}
+
+inline void deallocate(void *p) noexcept {
+    slab *s = slabOf(p);
+    if (s->owner == tls_cache)
+        s->owner->deallocate(p, s->size_class);
+    else
+        s->owner->remoteDeallocate(p, s->size_class);
+}
+
+} // namespace pool_detail
+
+// Deleter for make_pooled, empty so it costs unique_ptr nothing to carry
+template <class T>
+struct pool_delete {
+    constexpr pool_delete() noexcept = default;
+
+    // pooled_unique_ptr<Derived> -> pooled_unique_ptr<Base>, the block is
+    // found from the object so only the poolable-ness has to match
+    template <class U>
+    requires std::is_convertible_v<U*, T*> && (pool_detail::poolable<U> == pool_detail::poolable<T>)
+    pool_delete(const pool_delete<U>&) noexcept {}
+
+    void operator()(T *p) const noexcept {
+        if constexpr (!pool_detail::poolable<T>) {
+            delete p;
+        } else {
+            // A base pointer may not point at the start of the block
+            void *block;
+            if constexpr (std::is_polymorphic_v<T>)
+                block = dynamic_cast<void*>(p);
+            else
+                block = p;
+
+            p->~T();
+            pool_detail::deallocate(block);
+        }
+    }
+};
+
+template <class T>
+using pooled_unique_ptr = unique_ptr<T, pool_delete<T>>;
+
+template <class T, class... Args>
+requires (!std::is_array_v<T>)
+pooled_unique_ptr<T> make_pooled(Args&&... args) {
+    if constexpr (!pool_detail::poolable<T>) {
+        return pooled_unique_ptr<T>(new T(std::forward<Args>(args)...));
+    } else {
+        void *mem = pool_detail::allocate(sizeof(T));
+        try {
+            return pooled_unique_ptr<T>(::new (mem) T(std::forward<Args>(args)...));
+        } catch (...) {
+            pool_detail::deallocate(mem);
+            throw;
+        }
+    }
+}
+
+} // namespace My
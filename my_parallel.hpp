@@ -0,0 +1,262 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+#include "my_thread_pool.hpp"
+
+namespace My {
+
+/*
+ * Parallel algorithms over random access ranges (My::vector, std::vector,
+ * plain arrays), not defined in STL
+ * std::execution::par does the same but needs TBB behind libstdc++, these
+ * only need My::thread_pool.
+ *
+ *   My::parallel::for_each(v.begin(), v.end(), [](auto &x) { x *= 2; });
+ *   auto total = My::parallel::reduce(v.begin(), v.end(), 0.0);
+ *   My::parallel::sort(v.begin(), v.end());
+ *
+ * Ranges under serial_threshold elements (or a 1 thread pool) just call the
+ * std:: algorithm. Bigger ones are split in halves recursively down to a
+ * grain of about n / (8 * threads): enough pieces that stealing evens out
+ * uneven work, few enough that the per task overhead doesn't show.
+ *
+ * NOTE: reduce() needs op to be associative. The split only depends on n and
+ *       the pool size, so floating point results are reproducible for a given
+ *       pool, just not bit identical to std::accumulate
+ */
+
+namespace parallel {
+
+inline constexpr std::size_t serial_threshold = 1 << 14;
+
+// Pieces per thread, more pieces balance better and cost more
+inline constexpr std::size_t chunks_per_thread = 8;
+
+namespace detail {
+
+inline bool runSerial(std::size_t n, const thread_pool &pool) {
+    return n < serial_threshold || pool.size() < 2;
+}
+
+inline std::size_t grainFor(std::size_t n, const thread_pool &pool) {
+    return std::max<std::size_t>(serial_threshold / 4, n / (pool.size() * chunks_per_thread));
+}
+
+// Calls body(lo, hi) over [0, n) in pieces of at most grain, forking the
+// right half each time so thieves take the biggest pieces left
+template <class Body>
+void splitRange(task_group &group, std::size_t lo, std::size_t hi, std::size_t grain, const Body &body) {
+    while (hi - lo > grain) {
+        const std::size_t mid = lo + (hi - lo) / 2;
+        group.run([&group, mid, hi, grain, &body] { splitRange(group, mid, hi, grain, body); });
+        hi = mid;
+    }
+    body(lo, hi);
+}
+
+template <class Body>
+void forRange(thread_pool &pool, std::size_t n, const Body &body) {
+    task_group group(pool);
+    splitRange(group, 0, n, grainFor(n, pool), body);
+    group.wait();
+}
+
+// Splits [0, n) into k nearly equal pieces, piece i is [bound(i), bound(i + 1))
+inline std::size_t pieceBound(std::size_t n, std::size_t k, std::size_t i) {
+    return n / k * i + std::min(i, n % k);
+}
+
+inline std::size_t pieceCount(std::size_t n, const thread_pool &pool) {
+    return std::min(n / (serial_threshold / 4), pool.size() * std::size_t{2});
+}
+
+// Runs combine(lo, mid, hi) on neighbouring pieces, pairwise in parallel,
+// until one piece covers everything (log2(k) rounds)
+template <class Combine>
+void mergeTree(thread_pool &pool, std::vector<std::size_t> bounds, const Combine &combine) {
+    while (bounds.size() > 2) {
+        std::vector<std::size_t> next;
+        task_group group(pool);
+
+        std::size_t i = 0;
+        for (; i + 2 < bounds.size(); i += 2) {
+            const std::size_t lo = bounds[i], mid = bounds[i + 1], hi = bounds[i + 2];
+            group.run([&combine, lo, mid, hi] { combine(lo, mid, hi); });
+            next.push_back(lo);
+        }
+        // An odd piece out waits for the next round
+        if (i + 1 < bounds.size())
+            next.push_back(bounds[i]);
+        next.push_back(bounds.back());
+
+        group.wait();
+        bounds = std::move(next);
+    }
+}
+
+} // namespace detail
+
+template <std::random_access_iterator It, class F>
+void for_each(It first, It last, F f, thread_pool &pool = thread_pool::global()) {
+    const std::size_t n = last - first;
+    if (detail::runSerial(n, pool)) {
+        std::for_each(first, last, f);
+        return;
+    }
+
+    detail::forRange(pool, n, [&](std::size_t lo, std::size_t hi) {
+        std::for_each(first + lo, first + hi, f);
+    });
+}
+
+template <std::random_access_iterator It, std::random_access_iterator Out, class F>
+Out transform(It first, It last, Out dest, F f, thread_pool &pool = thread_pool::global()) {
+    const std::size_t n = last - first;
+    if (detail::runSerial(n, pool))
+        return std::transform(first, last, dest, f);
+
+    detail::forRange(pool, n, [&](std::size_t lo, std::size_t hi) {
+        std::transform(first + lo, first + hi, dest + lo, f);
+    });
+    return dest + n;
+}
+
+template <std::random_access_iterator It, class T, class Op = std::plus<>>
+T reduce(It first, It last, T init, Op op = {}, thread_pool &pool = thread_pool::global()) {
+    const std::size_t n = last - first;
+    if (detail::runSerial(n, pool))
+        return std::accumulate(first, last, std::move(init), op);
+
+    // A fixed number of pieces (not the stolen splits) so the result only
+    // depends on n and the pool size
+    const std::size_t k = pool.size() * chunks_per_thread;
+    std::vector<std::optional<T>> partial(k);
+
+    // Grain 1: k is far under grainFor's floor, which would run every piece
+    // on this thread
+    auto pieces = [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo; i < hi; ++i) {
+            const std::size_t b = detail::pieceBound(n, k, i), e = detail::pieceBound(n, k, i + 1);
+            if (b != e)
+                partial[i] = std::accumulate(first + b + 1, first + e, T(first[b]), op);
+        }
+    };
+    task_group group(pool);
+    detail::splitRange(group, 0, k, 1, pieces);
+    group.wait();
+
+    for (auto &p : partial)
+        if (p)
+            init = op(std::move(init), std::move(*p));
+    return init;
+}
+
+// Sorts pieces in parallel then merges neighbours pairwise, the last merge
+// is one serial pass over everything
+template <std::random_access_iterator It, class Compare = std::less<>>
+void sort(It first, It last, Compare comp = {}, thread_pool &pool = thread_pool::global()) {
+    const std::size_t n = last - first;
+    if (detail::runSerial(n, pool)) {
+        std::sort(first, last, comp);
+        return;
+    }
+
+    const std::size_t k = detail::pieceCount(n, pool);
+    std::vector<std::size_t> bounds(k + 1);
+    for (std::size_t i = 0; i <= k; ++i)
+        bounds[i] = detail::pieceBound(n, k, i);
+
+    {
+        task_group group(pool);
+        for (std::size_t i = 0; i < k; ++i)
+            group.run([&, i] { std::sort(first + bounds[i], first + bounds[i + 1], comp); });
+        group.wait();
+    }
+
+    detail::mergeTree(pool, bounds, [&](std::size_t lo, std::size_t mid, std::size_t hi) {
+        std::inplace_merge(first + lo, first + mid, first + hi, comp);
+    });
+}
+
+// Each piece is stable_partition'ed in parallel into [true | false], then
+// neighbours [T1 F1][T2 F2] become [T1 T2 | F1 F2] with one rotate
+template <std::random_access_iterator It, class Pred>
+It stable_partition(It first, It last, Pred pred, thread_pool &pool = thread_pool::global()) {
+    const std::size_t n = last - first;
+    if (detail::runSerial(n, pool))
+        return std::stable_partition(first, last, pred);
+
+    const std::size_t k = detail::pieceCount(n, pool);
+    std::vector<std::size_t> bounds(k + 1);
+    for (std::size_t i = 0; i <= k; ++i)
+        bounds[i] = detail::pieceBound(n, k, i);
+
+    // split[i] is where the block starting at bounds[i] switches from true to false
+    std::vector<std::size_t> split(k);
+    {
+        task_group group(pool);
+        for (std::size_t i = 0; i < k; ++i)
+            group.run([&, i] {
+                auto mid = std::stable_partition(first + bounds[i], first + bounds[i + 1], pred);
+                split[i] = mid - first;
+            });
+        group.wait();
+    }
+
+    auto pieceAt = [&](std::size_t offset) {
+        return std::lower_bound(bounds.begin(), bounds.end(), offset) - bounds.begin();
+    };
+
+    detail::mergeTree(pool, bounds, [&](std::size_t lo, std::size_t mid, std::size_t) {
+        const std::size_t left = pieceAt(lo), right = pieceAt(mid);
+        const std::size_t falseBegin = split[left], trueEnd = split[right];
+        std::rotate(first + falseBegin, first + mid, first + trueEnd);
+        split[left] = falseBegin + (trueEnd - mid);
+    });
+
+    return first + split[0];
+}
+
+inline int test() {
+    /* Test Cases */
+
+    thread_pool pool(4);
+
+    {
+        /* reduce keeps the order of the pieces and uses each exactly once:
+           composing affine maps x -> a*x + b is associative but not
+           commutative, so a piece missing, repeated or out of order shows */
+        struct affine {
+            std::uint64_t a, b;
+            bool operator==(const affine&) const = default;
+        };
+        auto compose = [](affine f, affine g) { return affine{g.a * f.a, g.a * f.b + g.b}; };
+
+        std::vector<affine> v(1 << 18);
+        std::uint64_t x = 1;
+        for (auto &f : v) {
+            x = x * 6364136223846793005ull + 1442695040888963407ull;
+            f = {x | 1, x >> 7};
+        }
+
+        const affine identity{1, 0};
+        assert(reduce(v.begin(), v.end(), identity, compose, pool)
+               == std::accumulate(v.begin(), v.end(), identity, compose));
+        std::cout << "Test 1 passed\n";
+    }
+
+    {
+        /* for_each visits every element exactly once */
+        std::vector<int> v(1 << 18, 0);
+        for_each(v.begin(), v.end(), [](int &n) { ++n; }, pool);
+        assert(std::all_of(v.begin(), v.end(), [](int n) { return n == 1; }));
+        std::cout << "Test 2 passed\n";
+    }
+
+    return 0;
+}
+
+} // namespace parallel
+
+} // namespace My
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+#include "my_instrument.hpp"
+#include "my_vector.hpp"
+
+namespace My {
+
+/*
+ * Vector made of fixed size chunks, not defined in STL (like std::deque
+ * without the front, or LLVM's SegmentedArray)
+ * Elements live in ChunkSize element chunks that are never moved, the
+ * container only keeps a directory of chunk pointers:
+ *
+ *   _dir  [c0][c1][c2]
+ *          |   |   |
+ *          v   v   v
+ *         [ChunkSize elements] ...
+ *
+ *  - operator[] is a shift, a mask and two loads
+ *  - push_back never relocates an element, so pointers and references stay
+ *    valid until that element is popped, and the worst case push_back is one
+ *    chunk allocation (plus a directory grow, which reserve() avoids)
+ *  - chunks emptied by pop_back()/clear() go on a free list and are reused
+ *    before anything new is allocated, shrink_to_fit() gives them back
+ *
+ * Chunks are cache line aligned and ChunkSize is a power of two, by default
+ * as many elements as fit in 4KB.
+ */
+
+template <class T>
+inline constexpr std::size_t default_segment_size = std::bit_floor(std::max<std::size_t>(1, 4096 / sizeof(T)));
+
+template <class T, std::size_t ChunkSize = default_segment_size<T>, class Allocator = std::allocator<T>>
+class segmented_vector {
+    static_assert(std::has_single_bit(ChunkSize), "ChunkSize must be a power of two");
+
+    struct chunk {
+        alignas(std::max<std::size_t>(64, alignof(T))) unsigned char raw[ChunkSize * sizeof(T)];
+
+        T* slots() noexcept { return std::launder(reinterpret_cast<T*>(raw)); }
+    };
+
+    using __alloc_traits  = instrument::traits_for<Allocator>;
+    using chunk_allocator = typename __alloc_traits::template rebind_alloc<chunk>;
+    using chunk_traits    = instrument::traits_for<chunk_allocator, T>;
+    using directory       = vector<chunk*, typename __alloc_traits::template rebind_alloc<chunk*>>;
+
+    static constexpr std::size_t shift = std::countr_zero(ChunkSize);
+    static constexpr std::size_t mask  = ChunkSize - 1;
+
+    template <bool Const>
+    class iterator_impl;
+
+public:
+    using value_type      = T;
+    using allocator_type  = Allocator;
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference       = value_type&;
+    using const_reference = const value_type&;
+    using pointer         = value_type*;
+    using const_pointer   = const value_type*;
+    using iterator        = iterator_impl<false>;
+    using const_iterator  = iterator_impl<true>;
+
+    static constexpr size_type chunk_size = ChunkSize;
+
+
+    /*** Constructors and Destructors***/
+    segmented_vector() = default;
+    explicit segmented_vector(const Allocator &alloc)
+    : _chunk_alloc(alloc), _dir(alloc), _spare(alloc) {}
+
+    segmented_vector(size_type count, const_reference value, const Allocator &alloc = Allocator())
+    : segmented_vector(alloc) {
+        reserve(count);
+        for (size_type i = 0; i < count; ++i)
+            push_back(value);
+    }
+
+    segmented_vector(std::initializer_list<value_type> init, const Allocator &alloc = Allocator())
+    : segmented_vector(alloc) {
+        reserve(init.size());
+        for (const auto &x : init)
+            push_back(x);
+    }
+
+    segmented_vector(const segmented_vector &other)
+    : segmented_vector(__alloc_traits::select_on_container_copy_construction(other.get_allocator())) {
+        reserve(other.size());
+        for (const auto &x : other)
+            push_back(x);
+    }
+
+    segmented_vector(segmented_vector &&other) noexcept
+    : _chunk_alloc(std::move(other._chunk_alloc)), _dir(std::move(other._dir)),
+      _spare(std::move(other._spare)), _size(std::exchange(other._size, 0)) {}
+
+    ~segmented_vector() {
+        clear();
+        freeChunks(_spare);
+    }
+
+    /*** Assignment operators ***/
+    // Copy-on-swap like My::vector
+    segmented_vector &operator=(const segmented_vector &other) {
+        if (this != &other) {
+            segmented_vector temp(other);
+            swap(temp);
+        }
+        return *this;
+    }
+
+    segmented_vector &operator=(segmented_vector &&other) noexcept {
+        segmented_vector temp(std::move(other));
+        swap(temp);
+        return *this;
+    }
+
+    allocator_type get_allocator() const noexcept { return allocator_type(_chunk_alloc); }
+
+    /*** Element access ***/
+    reference at(size_type pos) {
+        if (pos >= _size)
+            throw(std::out_of_range("Index out of range"));
+        return (*this)[pos];
+    }
+    const_reference at(size_type pos) const {
+        if (pos >= _size)
+            throw(std::out_of_range("Index out of range"));
+        return (*this)[pos];
+    }
+
+    reference operator[](size_type pos) noexcept { return _dir[pos >> shift]->slots()[pos & mask]; }
+    const_reference operator[](size_type pos) const noexcept { return _dir[pos >> shift]->slots()[pos & mask]; }
+
+    reference front() { return (*this)[0]; }
+    const_reference front() const { return (*this)[0]; }
+
+    reference back() { return (*this)[_size - 1]; }
+    const_reference back() const { return (*this)[_size - 1]; }
+
+    /*** Iterators ***/
+    iterator begin() noexcept { return iterator(this, 0); }
+    const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    const_iterator cbegin() const noexcept { return begin(); }
+
+    iterator end() noexcept { return iterator(this, _size); }
+    const_iterator end() const noexcept { return const_iterator(this, _size); }
+    const_iterator cend() const noexcept { return end(); }
+
+    /*** Capacity ***/
+    bool empty() const noexcept { return !_size; }
+    size_type size() const noexcept { return _size; }
+    size_type capacity() const noexcept { return (_dir.size() + _spare.size()) * ChunkSize; }
+
+    // Allocates the chunks and the directory up front, after that push_back
+    // up to newCap never allocates
+    void reserve(size_type newCap) {
+        const size_type chunks = (newCap + mask) >> shift;
+        reserveDirectories(chunks);
+
+        while (_dir.size() + _spare.size() < chunks)
+            _spare.push_back(allocateChunk());
+    }
+
+    // Frees the chunks on the free list. Both directories still fit every
+    // chunk afterwards (see reserveDirectories), _spare is rebuilt at that
+    // size before anything is given up so a throw leaves them as they were
+    void shrink_to_fit() {
+        freeChunks(_spare);
+
+        directory spare(_spare.get_allocator());
+        spare.reserve(_dir.size());
+        _dir.shrink_to_fit();
+        _spare.swap(spare);
+    }
+
+    /*** Modifiers ***/
+    void clear() noexcept {
+        while (_size)
+            pop_back();
+    }
+
+    void push_back(const_reference value) { emplace_back(value); }
+    void push_back(value_type &&value) { emplace_back(std::move(value)); }
+
+    // The element is built before a new chunk is linked in, so on an
+    // exception the container is unchanged (the chunk stays spare)
+    template <class... Args>
+    reference emplace_back(Args&&... args) {
+        if (_size == _dir.size() * ChunkSize && _spare.empty()) {
+            reserveDirectories(_dir.size() + 1);
+            _spare.push_back(allocateChunk());
+        }
+
+        chunk *c = (_size & mask) ? _dir.back() : _spare.back();
+        T *slot = c->slots() + (_size & mask);
+        Allocator alloc(_chunk_alloc);
+        __alloc_traits::construct(alloc, slot, std::forward<Args>(args)...);
+
+        if (!(_size & mask)) {
+            _dir.push_back(c);
+            _spare.pop_back();
+        }
+
+        ++_size;
+        return *slot;
+    }
+
+    void pop_back() noexcept {
+        --_size;
+        Allocator alloc(_chunk_alloc);
+        __alloc_traits::destroy(alloc, std::addressof((*this)[_size]));
+
+        if (!(_size & mask)) {
+            _spare.push_back(_dir.back());
+            _dir.pop_back();
+        }
+    }
+
+    void swap(segmented_vector &other) noexcept {
+        using std::swap;
+        swap(_chunk_alloc, other._chunk_alloc);
+        _dir.swap(other._dir);
+        _spare.swap(other._spare);
+        swap(_size, other._size);
+    }
+
+private:
+    [[no_unique_address]] chunk_allocator _chunk_alloc;
+    directory                             _dir;     // chunks holding elements, all full but the last
+    directory                             _spare;   // free list
+    size_type                             _size = 0;
+
+    // Every chunk is either in _dir or _spare, so with both able to hold all
+    // of them moving a chunk between the two never allocates (which keeps
+    // pop_back() noexcept). Grows geometrically like My::vector
+    void reserveDirectories(size_type chunks) {
+        if (chunks <= _dir.capacity() && chunks <= _spare.capacity())
+            return;
+
+        const size_type cap = std::max({chunks, _dir.capacity() * 2, size_type{4}});
+        _dir.reserve(cap);
+        _spare.reserve(cap);
+    }
+
+    chunk* allocateChunk() { return chunk_traits::allocate(_chunk_alloc, 1); }
+
+    void freeChunks(directory &chunks) noexcept {
+        for (chunk *c : chunks)
+            chunk_traits::deallocate(_chunk_alloc, c, 1);
+        chunks.clear();
+    }
+};
+
+/*
+ * Random access iterator, a container pointer and an index. The index is
+ * what's stable, so iterators stay valid across push_back (std::deque's
+ * don't).
+ */
+template <class T, std::size_t ChunkSize, class Allocator>
+template <bool Const>
+class segmented_vector<T, ChunkSize, Allocator>::iterator_impl {
+    using container = std::conditional_t<Const, const segmented_vector, segmented_vector>;
+
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type        = T;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = std::conditional_t<Const, const T*, T*>;
+    using reference         = std::conditional_t<Const, const T&, T&>;
+
+    iterator_impl() = default;
+    iterator_impl(container *c, size_type i) noexcept : _c(c), _i(i) {}
+
+    // iterator -> const_iterator
+    template <bool C = Const, class = std::enable_if_t<C>>
+    iterator_impl(const iterator_impl<false> &other) noexcept : _c(other._c), _i(other._i) {}
+
+    reference operator*() const noexcept { return (*_c)[_i]; }
+    pointer operator->() const noexcept { return std::addressof((*_c)[_i]); }
+    reference operator[](difference_type n) const noexcept { return (*_c)[_i + n]; }
+
+    iterator_impl &operator++() noexcept { ++_i; return *this; }
+    iterator_impl operator++(int) noexcept { auto out = *this; ++_i; return out; }
+    iterator_impl &operator--() noexcept { --_i; return *this; }
+    iterator_impl operator--(int) noexcept { auto out = *this; --_i; return out; }
+
+    iterator_impl &operator+=(difference_type n) noexcept { _i += n; return *this; }
+    iterator_impl &operator-=(difference_type n) noexcept { _i -= n; return *this; }
+
+    friend iterator_impl operator+(iterator_impl it, difference_type n) noexcept { return it += n; }
+    friend iterator_impl operator+(difference_type n, iterator_impl it) noexcept { return it += n; }
+    friend iterator_impl operator-(iterator_impl it, difference_type n) noexcept { return it -= n; }
+    friend difference_type operator-(const iterator_impl &a, const iterator_impl &b) noexcept {
+        return static_cast<difference_type>(a._i) - static_cast<difference_type>(b._i);
+    }
+
+    friend bool operator==(const iterator_impl &a, const iterator_impl &b) noexcept { return a._i == b._i; }
+    friend auto operator<=>(const iterator_impl &a, const iterator_impl &b) noexcept { return a._i <=> b._i; }
+
+private:
+    friend class iterator_impl<!Const>;
+
+    container *_c = nullptr;
+    size_type  _i = 0;
+};
+
+template <class T, std::size_t ChunkSize, class Allocator>
+void swap(segmented_vector<T, ChunkSize, Allocator> &lhs,
+          segmented_vector<T, ChunkSize, Allocator> &rhs) noexcept {
+    lhs.swap(rhs);
+}
+
+} // namespace My
@@ -0,0 +1,469 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+namespace My {
+
+/*
+ * My (custom) implementation of C++'s shared_ptr
+ * https://en.cppreference.com/w/cpp/memory/shared_ptr.html
+ * The reference count is a policy:
+ *
+ *   atomic_count         what std::shared_ptr does, copies can cross threads
+ *   single_thread_count  plain ++/--, for pointers that never leave a thread
+ *                        (local_shared_ptr), copies cost nothing extra
+ *
+ *   auto snap = My::make_shared<snapshot>(book);                   // atomic
+ *   auto view = My::make_local_shared<snapshot>(book);             // thread confined
+ *
+ * make_shared puts the count and the object in one allocation. There's no
+ * weak_ptr, so the object and its block always go away together.
+ *
+ * intrusive_ptr is for types that carry their own count (derive from
+ * ref_counted), it's one pointer wide and needs no control block at all.
+ *
+ * NOTE: a single_thread_count pointer copied to another thread is a data
+ *       race on the count, nothing checks for it
+ */
+
+/*** Reference count policies ***/
+struct atomic_count {
+    using type = std::atomic<std::size_t>;
+
+    static void increment(type &c) noexcept { c.fetch_add(1, std::memory_order_relaxed); }
+
+    // True when this was the last reference, the acquire makes every other
+    // owner's writes visible to whoever destroys the object
+    static bool decrement(type &c) noexcept {
+        return c.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    static std::size_t load(const type &c) noexcept { return c.load(std::memory_order_relaxed); }
+};
+
+struct single_thread_count {
+    using type = std::size_t;
+
+    static void increment(type &c) noexcept { ++c; }
+    static bool decrement(type &c) noexcept { return --c == 0; }
+    static std::size_t load(const type &c) noexcept { return c; }
+};
+
+namespace shared_detail {
+
+// Count plus how to get rid of the object and the block itself
+template <class Policy>
+struct control_block {
+    typename Policy::type count{1};
+
+    virtual void release() noexcept = 0;
+
+protected:
+    ~control_block() = default;
+};
+
+// shared_ptr(p, d): the object was allocated separately
+template <class Policy, class T, class Deleter>
+struct pointer_block final : control_block<Policy> {
+    T                             *ptr;
+    [[no_unique_address]] Deleter  del;
+
+    pointer_block(T *p, Deleter d) : ptr(p), del(std::move(d)) {}
+
+    void release() noexcept override {
+        del(ptr);
+        delete this;
+    }
+};
+
+// make_shared: the object lives in the block
+template <class Policy, class T>
+struct inplace_block final : control_block<Policy> {
+    union { T value; };
+
+    template <class... Args>
+    explicit inplace_block(Args&&... args) { ::new (static_cast<void*>(std::addressof(value))) T(std::forward<Args>(args)...); }
+
+    ~inplace_block() {}
+
+    void release() noexcept override {
+        value.~T();
+        delete this;
+    }
+};
+
+} // namespace shared_detail
+
+template <class T, class Policy = atomic_count>
+class shared_ptr {
+    using block = shared_detail::control_block<Policy>;
+
+public:
+    using element_type = std::remove_extent_t<T>;
+    using policy_type  = Policy;
+
+
+    // Constructors
+    constexpr shared_ptr() noexcept = default;
+    constexpr shared_ptr(std::nullptr_t) noexcept {}
+
+    // shared_ptr<T[]> has to delete[], default_delete<T[]> does
+    template <class U>
+    requires std::is_convertible_v<U*, element_type*>
+    explicit shared_ptr(U *p)
+    : shared_ptr(p, std::conditional_t<std::is_array_v<T>, std::default_delete<T>, std::default_delete<U>>()) {}
+
+    // d(p) is called even when allocating the block throws
+    template <class U, class Deleter>
+    requires std::is_convertible_v<U*, element_type*>
+    shared_ptr(U *p, Deleter d) : _ptr(p) {
+        try {
+            _ctrl = new shared_detail::pointer_block<Policy, U, Deleter>(p, d);
+        } catch (...) {
+            d(p);
+            throw;
+        }
+    }
+
+    // Aliasing: shares other's ownership but points at p (usually a member)
+    template <class U>
+    shared_ptr(const shared_ptr<U, Policy> &other, element_type *p) noexcept
+    : _ptr(p), _ctrl(other._ctrl) {
+        if (_ctrl)
+            Policy::increment(_ctrl->count);
+    }
+
+
+    // Copy and move ctors
+    shared_ptr(const shared_ptr &other) noexcept : _ptr(other._ptr), _ctrl(other._ctrl) {
+        if (_ctrl)
+            Policy::increment(_ctrl->count);
+    }
+
+    template <class U>
+    requires std::is_convertible_v<U*, element_type*>
+    shared_ptr(const shared_ptr<U, Policy> &other) noexcept : _ptr(other._ptr), _ctrl(other._ctrl) {
+        if (_ctrl)
+            Policy::increment(_ctrl->count);
+    }
+
+    shared_ptr(shared_ptr &&other) noexcept
+    : _ptr(std::exchange(other._ptr, nullptr)), _ctrl(std::exchange(other._ctrl, nullptr)) {}
+
+    template <class U>
+    requires std::is_convertible_v<U*, element_type*>
+    shared_ptr(shared_ptr<U, Policy> &&other) noexcept
+    : _ptr(std::exchange(other._ptr, nullptr)), _ctrl(std::exchange(other._ctrl, nullptr)) {}
+
+    ~shared_ptr() {
+        if (_ctrl && Policy::decrement(_ctrl->count))
+            _ctrl->release();
+    }
+
+
+    // Assignment, copy-and-swap like the containers
+    shared_ptr& operator=(const shared_ptr &other) noexcept {
+        shared_ptr(other).swap(*this);
+        return *this;
+    }
+
+    shared_ptr& operator=(shared_ptr &&other) noexcept {
+        shared_ptr(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    template <class U>
+    shared_ptr& operator=(const shared_ptr<U, Policy> &other) noexcept {
+        shared_ptr(other).swap(*this);
+        return *this;
+    }
+
+    template <class U>
+    shared_ptr& operator=(shared_ptr<U, Policy> &&other) noexcept {
+        shared_ptr(std::move(other)).swap(*this);
+        return *this;
+    }
+
+
+    // Modifiers
+    void reset() noexcept { shared_ptr().swap(*this); }
+
+    template <class U>
+    void reset(U *p) { shared_ptr(p).swap(*this); }
+
+    template <class U, class Deleter>
+    void reset(U *p, Deleter d) { shared_ptr(p, std::move(d)).swap(*this); }
+
+    void swap(shared_ptr &other) noexcept {
+        std::swap(_ptr, other._ptr);
+        std::swap(_ctrl, other._ctrl);
+    }
+
+
+    /*** Observers ***/
+    element_type* get() const noexcept { return _ptr; }
+    explicit operator bool() const noexcept { return _ptr; }
+
+    std::add_lvalue_reference_t<element_type> operator*() const noexcept { return *_ptr; }
+    element_type* operator->() const noexcept { return _ptr; }
+
+    std::size_t use_count() const noexcept { return _ctrl ? Policy::load(_ctrl->count) : 0; }
+
+    // Ordering by control block, so aliases of one object compare equivalent
+    template <class U>
+    bool owner_before(const shared_ptr<U, Policy> &other) const noexcept {
+        return std::less<>()(_ctrl, other._ctrl);
+    }
+
+private:
+    template <class U, class P> friend class shared_ptr;
+
+    template <class U, class P, class... Args>
+    friend shared_ptr<U, P> make_shared(Args&&... args);
+
+    element_type *_ptr  = nullptr;
+    block        *_ctrl = nullptr;
+};
+
+template <class T, class U, class P>
+bool operator==(const shared_ptr<T, P> &lhs, const shared_ptr<U, P> &rhs) noexcept {
+    return lhs.get() == rhs.get();
+}
+
+template <class T, class P>
+bool operator==(const shared_ptr<T, P> &lhs, std::nullptr_t) noexcept {
+    return !lhs;
+}
+
+template <class T, class U, class P>
+auto operator<=>(const shared_ptr<T, P> &lhs, const shared_ptr<U, P> &rhs) noexcept {
+    return std::compare_three_way()(lhs.get(), rhs.get());
+}
+
+template <class T, class P>
+void swap(shared_ptr<T, P> &lhs, shared_ptr<T, P> &rhs) noexcept {
+    lhs.swap(rhs);
+}
+
+template <class T>
+using local_shared_ptr = shared_ptr<T, single_thread_count>;
+
+// One allocation for the count and the object
+template <class T, class Policy = atomic_count, class... Args>
+shared_ptr<T, Policy> make_shared(Args&&... args) {
+    static_assert(!std::is_array_v<T>, "My::make_shared doesn't do arrays");
+
+    auto *b = new shared_detail::inplace_block<Policy, T>(std::forward<Args>(args)...);
+
+    shared_ptr<T, Policy> out;
+    out._ptr  = std::addressof(b->value);
+    out._ctrl = b;
+    return out;
+}
+
+template <class T, class... Args>
+local_shared_ptr<T> make_local_shared(Args&&... args) {
+    return make_shared<T, single_thread_count>(std::forward<Args>(args)...);
+}
+
+
+/*** Intrusive ***/
+// Base for types that hold their own count, the copy constructor and
+// assignment deliberately don't copy it
+template <class Policy = atomic_count>
+class ref_counted {
+public:
+    void add_ref() const noexcept { Policy::increment(_refs); }
+    bool release_ref() const noexcept { return Policy::decrement(_refs); }
+    std::size_t ref_count() const noexcept { return Policy::load(_refs); }
+
+protected:
+    ref_counted() noexcept = default;
+    ref_counted(const ref_counted&) noexcept {}
+    ref_counted& operator=(const ref_counted&) noexcept { return *this; }
+    ~ref_counted() = default;
+
+private:
+    mutable typename Policy::type _refs{0};
+};
+
+template <class T>
+concept intrusively_counted = requires(const T *p) {
+    p->add_ref();
+    { p->release_ref() } -> std::convertible_to<bool>;
+};
+
+// Deletes with plain delete when the last reference goes, so T must come
+// from new (and have a virtual destructor if held through a base)
+template <class T>
+class intrusive_ptr {
+public:
+    using element_type = T;
+
+    constexpr intrusive_ptr() noexcept = default;
+    constexpr intrusive_ptr(std::nullptr_t) noexcept {}
+
+    // Takes a reference, so intrusive_ptr(new T) starts the count at 1
+    explicit intrusive_ptr(T *p) noexcept : _ptr(p) {
+        static_assert(intrusively_counted<T>, "T needs add_ref() and release_ref(), see ref_counted");
+        if (_ptr)
+            _ptr->add_ref();
+    }
+
+    intrusive_ptr(const intrusive_ptr &other) noexcept : intrusive_ptr(other._ptr) {}
+
+    template <class U>
+    requires std::is_convertible_v<U*, T*>
+    intrusive_ptr(const intrusive_ptr<U> &other) noexcept : intrusive_ptr(other.get()) {}
+
+    intrusive_ptr(intrusive_ptr &&other) noexcept : _ptr(std::exchange(other._ptr, nullptr)) {}
+
+    template <class U>
+    requires std::is_convertible_v<U*, T*>
+    intrusive_ptr(intrusive_ptr<U> &&other) noexcept : _ptr(other.detach()) {}
+
+    ~intrusive_ptr() {
+        if (_ptr && _ptr->release_ref())
+            delete _ptr;
+    }
+
+    intrusive_ptr& operator=(const intrusive_ptr &other) noexcept {
+        intrusive_ptr(other).swap(*this);
+        return *this;
+    }
+
+    intrusive_ptr& operator=(intrusive_ptr &&other) noexcept {
+        intrusive_ptr(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    void reset(T *p = nullptr) noexcept { intrusive_ptr(p).swap(*this); }
+
+    // Gives up the reference without dropping it
+    T* detach() noexcept { return std::exchange(_ptr, nullptr); }
+
+    void swap(intrusive_ptr &other) noexcept { std::swap(_ptr, other._ptr); }
+
+    T* get() const noexcept { return _ptr; }
+    explicit operator bool() const noexcept { return _ptr; }
+    T& operator*() const noexcept { return *_ptr; }
+    T* operator->() const noexcept { return _ptr; }
+
+private:
+    T *_ptr = nullptr;
+};
+
+template <class T, class U>
+bool operator==(const intrusive_ptr<T> &lhs, const intrusive_ptr<U> &rhs) noexcept {
+    return lhs.get() == rhs.get();
+}
+
+template <class T>
+bool operator==(const intrusive_ptr<T> &lhs, std::nullptr_t) noexcept {
+    return !lhs;
+}
+
+template <class T>
+void swap(intrusive_ptr<T> &lhs, intrusive_ptr<T> &rhs) noexcept {
+    lhs.swap(rhs);
+}
+
+template <class T, class... Args>
+intrusive_ptr<T> make_intrusive(Args&&... args) {
+    return intrusive_ptr<T>(new T(std::forward<Args>(args)...));
+}
+
+inline int test_shared_ptr() {
+    /* Test Cases */
+
+    {
+        /* Copies share one count, the last owner deletes */
+        static int alive = 0;
+        struct X {
+            X() { ++alive; }
+            ~X() { --alive; }
+        };
+
+        My::shared_ptr<X> a(new X);
+        {
+            My::shared_ptr<X> b = a;
+            assert(a.use_count() == 2);
+            assert(a == b);
+        }
+        assert(a.use_count() == 1);
+        a.reset();
+        assert(!a && alive == 0);
+        std::cout << "Test 1 passed\n";
+    }
+
+    {
+        /* Arrays are deleted with delete[] (ASan flags a mismatch) */
+        My::shared_ptr<int[]> arr(new int[4]{1, 2, 3, 4});
+        assert(arr.get()[3] == 4);
+        arr.reset(new int[2]);
+        arr.reset();
+        std::cout << "Test 2 passed\n";
+    }
+
+    {
+        /* make_shared puts the object in the block: T's own operator new
+           only runs for shared_ptr(new T) */
+        static int classNews = 0;
+        struct Y {
+            int v;
+            explicit Y(int v) : v(v) {}
+            static void* operator new(std::size_t n) { ++classNews; return ::operator new(n); }
+            static void operator delete(void *p) { ::operator delete(p); }
+        };
+
+        auto made = My::make_shared<Y>(5);
+        assert(made->v == 5 && classNews == 0);
+        My::shared_ptr<Y> separate(new Y(6));
+        assert(separate->v == 6 && classNews == 1);
+
+        // Aliasing keeps the whole object alive
+        My::shared_ptr<int> member(made, &made->v);
+        made.reset();
+        assert(*member == 5 && member.use_count() == 1);
+        std::cout << "Test 3 passed\n";
+    }
+
+    {
+        /* local_shared_ptr, plain counts */
+        auto p = My::make_local_shared<std::string>("book");
+        static_assert(std::is_same_v<decltype(p)::policy_type, My::single_thread_count>);
+        auto q = p;
+        assert(p.use_count() == 2 && *q == "book");
+        q.reset();
+        assert(p.use_count() == 1);
+        std::cout << "Test 4 passed\n";
+    }
+
+    {
+        /* intrusive_ptr, one pointer wide, count in the object */
+        static int alive = 0;
+        struct Z : My::ref_counted<> {
+            Z() { ++alive; }
+            ~Z() { --alive; }
+        };
+        static_assert(sizeof(My::intrusive_ptr<Z>) == sizeof(Z*));
+
+        auto a = My::make_intrusive<Z>();
+        {
+            My::intrusive_ptr<Z> b = a;
+            assert(a->ref_count() == 2);
+        }
+        Z *raw = a.detach();
+        assert(!a && raw->ref_count() == 1);
+        My::intrusive_ptr<Z> c(raw);       // takes a second reference
+        raw->release_ref();                // drop the detached one
+        assert(c->ref_count() == 1);
+        c.reset();
+        assert(alive == 0);
+        std::cout << "Test 5 passed\n";
+    }
+
+    return 0;
+}
+
+} // namespace My
@@ -0,0 +1,339 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+namespace My {
+
+/*
+ * SIMD kernels over contiguous arrays of arithmetic types, not defined in STL
+ * fill, copy, equal, find, min, max and sum, each written once against GCC's
+ * generic vector types (T __attribute__((vector_size(N)))) and compiled three
+ * times: AVX2 (32 byte vectors), SSE4.2 (16 byte vectors) and a plain scalar
+ * loop. The CPU is checked once at startup and every call branches on it, so
+ * the binary still runs on machines without AVX2.
+ *
+ * My::vector uses fill/copy/equal for arithmetic T, the rest take a pointer
+ * and a count or any contiguous range:
+ *
+ *   My::vector<double> px = ...;
+ *   double hi  = My::simd::max(px);
+ *   double vol = My::simd::sum(sizes);
+ *
+ * NOTE: sum() of floats adds in a different order than a plain loop, so the
+ *       last bits can differ. Integer sums wrap in T like std::accumulate.
+ *       min()/max() need a non empty range, with NaNs the result is unspecified
+ */
+
+namespace simd {
+
+// long double has no vector type, bool has no arithmetic worth vectorizing
+template <class T>
+concept vectorizable = std::is_arithmetic_v<T>
+                       && !std::is_same_v<T, bool>
+                       && !std::is_same_v<T, long double>;
+
+enum class isa { scalar, sse42, avx2 };
+
+inline isa detect() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return isa::avx2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return isa::sse42;
+#endif
+    return isa::scalar;
+}
+
+// Zero (scalar) until it's initialized, so a kernel called from another
+// static initializer is still correct, just not vectorized
+inline const isa cpu = detect();
+
+namespace detail {
+
+// The helpers below pass 32 byte vectors around but are always inlined into
+// an AVX2 function, so the ABI note GCC gives for them doesn't apply
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+// A dependent vector_size only works on a typedef inside a class template
+template <class T, std::size_t Bytes>
+struct vec_of {
+    typedef T type __attribute__((vector_size(Bytes)));
+};
+
+template <class T, std::size_t Bytes>
+using vec = typename vec_of<T, Bytes>::type;
+
+// Unaligned loads and stores, memcpy compiles down to a single mov
+template <class V, class T>
+[[gnu::always_inline]] inline V load(const T *p) noexcept {
+    V v;
+    std::memcpy(&v, p, sizeof(V));
+    return v;
+}
+
+template <class V, class T>
+[[gnu::always_inline]] inline void store(T *p, const V &v) noexcept {
+    std::memcpy(p, &v, sizeof(V));
+}
+
+// True if any lane of a comparison mask is set
+template <class M>
+[[gnu::always_inline]] inline bool any(const M &mask) noexcept {
+    using U = vec<std::uint64_t, sizeof(M)>;
+    const U u = load<U>(reinterpret_cast<const unsigned char*>(&mask));
+
+    std::uint64_t out = 0;
+    for (std::size_t i = 0; i < sizeof(M) / 8; ++i)
+        out |= u[i];
+    return out;
+}
+
+/*** Kernels ***/
+// Each one does whole vectors (unrolled where there's a dependency chain to
+// hide) and finishes the last n % lanes elements one at a time
+
+template <std::size_t Bytes, class T>
+[[gnu::always_inline]] inline void fillKernel(T *p, std::size_t n, T value) noexcept {
+    using V = vec<T, Bytes>;
+    constexpr std::size_t lanes = Bytes / sizeof(T);
+
+    const V v = V{} + value;
+    std::size_t i = 0;
+    for (; i + lanes <= n; i += lanes)
+        store(p + i, v);
+    for (; i < n; ++i)
+        p[i] = value;
+}
+
+template <std::size_t Bytes, class T>
+[[gnu::always_inline]] inline bool equalKernel(const T *a, const T *b, std::size_t n) noexcept {
+    using V = vec<T, Bytes>;
+    constexpr std::size_t lanes = Bytes / sizeof(T);
+
+    std::size_t i = 0;
+    for (; i + 2 * lanes <= n; i += 2 * lanes) {
+        auto diff = (load<V>(a + i) != load<V>(b + i))
+                  | (load<V>(a + i + lanes) != load<V>(b + i + lanes));
+        if (any(diff))
+            return false;
+    }
+    for (; i < n; ++i)
+        if (!(a[i] == b[i]))
+            return false;
+    return true;
+}
+
+template <std::size_t Bytes, class T>
+[[gnu::always_inline]] inline std::size_t findKernel(const T *p, std::size_t n, T value) noexcept {
+    using V = vec<T, Bytes>;
+    constexpr std::size_t lanes = Bytes / sizeof(T);
+
+    const V v = V{} + value;
+    std::size_t i = 0;
+    for (; i + lanes <= n; i += lanes)
+        if (any(load<V>(p + i) == v))
+            break;
+    for (; i < n; ++i)
+        if (p[i] == value)
+            return i;
+    return n;
+}
+
+// min() or max(), Max picks the comparison
+template <std::size_t Bytes, bool Max, class T>
+[[gnu::always_inline]] inline T reduceKernel(const T *p, std::size_t n) noexcept {
+    using V = vec<T, Bytes>;
+    constexpr std::size_t lanes = Bytes / sizeof(T);
+
+#define MY_SIMD_BETTER(a, b) (Max ? (a) > (b) : (a) < (b))
+
+    T out = p[0];
+    std::size_t i = 0;
+
+    if (n >= 2 * lanes) {
+        V acc0 = load<V>(p), acc1 = load<V>(p + lanes);
+        for (i = 2 * lanes; i + 2 * lanes <= n; i += 2 * lanes) {
+            const V x0 = load<V>(p + i), x1 = load<V>(p + i + lanes);
+            acc0 = MY_SIMD_BETTER(x0, acc0) ? x0 : acc0;
+            acc1 = MY_SIMD_BETTER(x1, acc1) ? x1 : acc1;
+        }
+        acc0 = MY_SIMD_BETTER(acc1, acc0) ? acc1 : acc0;
+
+        out = acc0[0];
+        for (std::size_t l = 1; l < lanes; ++l)
+            if (MY_SIMD_BETTER(acc0[l], out))
+                out = acc0[l];
+    }
+
+    for (; i < n; ++i)
+        if (MY_SIMD_BETTER(p[i], out))
+            out = p[i];
+    return out;
+
+#undef MY_SIMD_BETTER
+}
+
+// Integers are added as unsigned so overflow wraps instead of being UB
+template <class T>
+struct sum_type_of { using type = T; };
+
+template <std::integral T>
+struct sum_type_of<T> { using type = std::make_unsigned_t<T>; };
+
+template <class T>
+using sum_type = typename sum_type_of<T>::type;
+
+template <class T>
+T sumScalar(const T *p, std::size_t n) noexcept {
+    sum_type<T> out{};
+    for (std::size_t i = 0; i < n; ++i)
+        out += static_cast<sum_type<T>>(p[i]);
+    return static_cast<T>(out);
+}
+
+// 4 accumulators since an add has 3-4 cycles of latency and 2 issue per cycle
+template <std::size_t Bytes, class T>
+[[gnu::always_inline]] inline T sumKernel(const T *p, std::size_t n) noexcept {
+    using A = sum_type<T>;
+    using V = vec<A, Bytes>;
+    constexpr std::size_t lanes = Bytes / sizeof(T);
+
+    V acc0{}, acc1{}, acc2{}, acc3{};
+    std::size_t i = 0;
+    for (; i + 4 * lanes <= n; i += 4 * lanes) {
+        acc0 += load<V>(p + i);
+        acc1 += load<V>(p + i + lanes);
+        acc2 += load<V>(p + i + 2 * lanes);
+        acc3 += load<V>(p + i + 3 * lanes);
+    }
+    acc0 = (acc0 + acc1) + (acc2 + acc3);
+
+    A out{};
+    for (std::size_t l = 0; l < lanes; ++l)
+        out += acc0[l];
+    for (; i < n; ++i)
+        out += static_cast<A>(p[i]);
+    return static_cast<T>(out);
+}
+
+/*** Per ISA entry points ***/
+// One wrapper per kernel per ISA, the kernel is inlined into each so it's
+// compiled with that ISA's instructions. The scalar versions are plain loops.
+#define MY_SIMD_TARGETS(name, ret, params, call)                                          \
+    template <class T> [[gnu::target("avx2")]] ret name##_avx2 params { return call(32); } \
+    template <class T> [[gnu::target("sse4.2")]] ret name##_sse42 params { return call(16); }
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MY_SIMD_CALL_FILL(bytes)   fillKernel<bytes>(p, n, value)
+#define MY_SIMD_CALL_EQUAL(bytes)  equalKernel<bytes>(a, b, n)
+#define MY_SIMD_CALL_FIND(bytes)   findKernel<bytes>(p, n, value)
+#define MY_SIMD_CALL_MIN(bytes)    reduceKernel<bytes, false>(p, n)
+#define MY_SIMD_CALL_MAX(bytes)    reduceKernel<bytes, true>(p, n)
+#define MY_SIMD_CALL_SUM(bytes)    sumKernel<bytes>(p, n)
+
+MY_SIMD_TARGETS(fill,  void,        (T *p, std::size_t n, T value),          MY_SIMD_CALL_FILL)
+MY_SIMD_TARGETS(equal, bool,        (const T *a, const T *b, std::size_t n), MY_SIMD_CALL_EQUAL)
+MY_SIMD_TARGETS(find,  std::size_t, (const T *p, std::size_t n, T value),    MY_SIMD_CALL_FIND)
+MY_SIMD_TARGETS(min,   T,           (const T *p, std::size_t n),             MY_SIMD_CALL_MIN)
+MY_SIMD_TARGETS(max,   T,           (const T *p, std::size_t n),             MY_SIMD_CALL_MAX)
+MY_SIMD_TARGETS(sum,   T,           (const T *p, std::size_t n),             MY_SIMD_CALL_SUM)
+
+#undef MY_SIMD_CALL_FILL
+#undef MY_SIMD_CALL_EQUAL
+#undef MY_SIMD_CALL_FIND
+#undef MY_SIMD_CALL_MIN
+#undef MY_SIMD_CALL_MAX
+#undef MY_SIMD_CALL_SUM
+#endif
+#undef MY_SIMD_TARGETS
+
+#pragma GCC diagnostic pop
+
+// Picks the wrapper for the CPU, falls back to the scalar expression
+#if defined(__x86_64__) || defined(__i386__)
+#define MY_SIMD_DISPATCH(name, args, scalar)          \
+    switch (cpu) {                                    \
+    case isa::avx2:  return detail::name##_avx2 args;  \
+    case isa::sse42: return detail::name##_sse42 args; \
+    default:         return scalar;                   \
+    }
+#else
+#define MY_SIMD_DISPATCH(name, args, scalar) return scalar;
+#endif
+
+} // namespace detail
+
+/*** Pointer + count API ***/
+template <vectorizable T>
+void fill(T *p, std::size_t n, T value) noexcept {
+    MY_SIMD_DISPATCH(fill, (p, n, value), static_cast<void>(std::fill_n(p, n, value)))
+}
+
+// glibc's memcpy already picks an AVX2/ERMS version at load time, there's
+// nothing to add on top
+template <vectorizable T>
+void copy(const T *src, std::size_t n, T *dest) noexcept {
+    if (n)
+        std::memcpy(dest, src, n * sizeof(T));
+}
+
+// Element wise ==, so 0.0 equals -0.0 and NaN equals nothing (unlike memcmp)
+template <vectorizable T>
+bool equal(const T *a, const T *b, std::size_t n) noexcept {
+    MY_SIMD_DISPATCH(equal, (a, b, n), std::equal(a, a + n, b))
+}
+
+// Index of the first element equal to value, n if there isn't one
+template <vectorizable T>
+std::size_t find(const T *p, std::size_t n, T value) noexcept {
+    MY_SIMD_DISPATCH(find, (p, n, value), static_cast<std::size_t>(std::find(p, p + n, value) - p))
+}
+
+template <vectorizable T>
+T min(const T *p, std::size_t n) noexcept {
+    MY_SIMD_DISPATCH(min, (p, n), *std::min_element(p, p + n))
+}
+
+template <vectorizable T>
+T max(const T *p, std::size_t n) noexcept {
+    MY_SIMD_DISPATCH(max, (p, n), *std::max_element(p, p + n))
+}
+
+template <vectorizable T>
+T sum(const T *p, std::size_t n) noexcept {
+    MY_SIMD_DISPATCH(sum, (p, n), detail::sumScalar(p, n))
+}
+
+#undef MY_SIMD_DISPATCH
+
+/*** Range API ***/
+// Anything contiguous: My::vector, std::vector, std::array, spans
+template <class R>
+concept vectorizable_range = std::ranges::contiguous_range<R> && std::ranges::sized_range<R>
+                             && vectorizable<std::ranges::range_value_t<R>>;
+
+template <vectorizable_range R>
+bool equal(const R &a, const R &b) noexcept {
+    return std::ranges::size(a) == std::ranges::size(b)
+           && equal(std::ranges::data(a), std::ranges::data(b), std::ranges::size(a));
+}
+
+template <vectorizable_range R>
+auto find(R &r, std::ranges::range_value_t<R> value) noexcept {
+    return std::ranges::begin(r) + find(std::ranges::data(r), std::ranges::size(r), value);
+}
+
+template <vectorizable_range R>
+auto min(const R &r) noexcept { return min(std::ranges::data(r), std::ranges::size(r)); }
+
+template <vectorizable_range R>
+auto max(const R &r) noexcept { return max(std::ranges::data(r), std::ranges::size(r)); }
+
+template <vectorizable_range R>
+auto sum(const R &r) noexcept { return sum(std::ranges::data(r), std::ranges::size(r)); }
+
+} // namespace simd
+
+} // namespace My
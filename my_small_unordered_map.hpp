@@ -0,0 +1,426 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+#include "my_unordered_map.hpp"
+
+namespace My {
+
+/*
+ * unordered_map with inline storage for small sizes, not defined in STL
+ * (same idea as LLVM's SmallDenseMap)
+ * The first N elements live in an array inside the object and lookups are a
+ * linear scan with KeyEqual, no hashing and no allocation. Inserting the
+ * N+1-th element moves everything into a regular My::unordered_map and the
+ * map stays hashed from then on (clear() included, the buckets are kept).
+ *
+ * Iterator invalidation
+ * Same as My::unordered_map, plus:
+ * insert, emplace, operator[] - Always when it causes the switch to hashed
+ * erase (small mode)          - The erased element and the last one, the
+ *                               last element is moved into the hole
+ */
+
+template <typename Key,
+          typename T,
+          std::size_t N      = 8,
+          typename Hash      = My::hash<Key>,
+          typename KeyEqual  = std::equal_to<Key>,
+          typename Allocator = std::allocator<std::pair<const Key, T>>>
+class small_unordered_map {
+    static_assert(N > 0, "Use My::unordered_map directly for N == 0");
+
+    using map_type = unordered_map<Key, T, Hash, KeyEqual, Allocator>;
+
+    template <class K>
+    static constexpr bool is_transparent = transparent_lookup<Hash, KeyEqual>;
+
+    // Moving the inline slots moves (and for the const key copies) each
+    // element, which may throw like in My::vector's relocate
+    static constexpr bool nothrow_move = std::is_nothrow_move_constructible_v<std::pair<const Key, T>>;
+
+public:
+    /*** C++ Standard Named Requirements for Containers***/
+    using key_type        = Key;
+    using mapped_type     = T;
+    using value_type      = std::pair<const Key, T>;
+    using hasher          = Hash;
+    using key_equal       = KeyEqual;
+    using allocator_type  = Allocator;
+    using size_type       = typename map_type::size_type;
+    using difference_type = typename map_type::difference_type;
+    using reference       = value_type&;
+    using const_reference = const value_type&;
+
+    // Walks the inline array in small mode and the map's node list otherwise
+    template <bool Const>
+    class iterator_impl {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = std::pair<const Key, T>;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = std::conditional_t<Const, const value_type*, value_type*>;
+        using reference         = std::conditional_t<Const, const value_type&, value_type&>;
+
+    private:
+        using ptr_type = pointer;
+        using map_iter = std::conditional_t<Const, typename map_type::const_iterator,
+                                                   typename map_type::iterator>;
+
+    public:
+
+        iterator_impl() noexcept = default;
+        explicit iterator_impl(ptr_type p) noexcept : _ptr(p) {}
+        explicit iterator_impl(map_iter it) noexcept : _it(it) {}
+
+        // iterator -> const_iterator
+        template <bool C = Const, std::enable_if_t<C, int> = 0>
+        iterator_impl(const iterator_impl<false> &other) noexcept
+            : _ptr(other._ptr), _it(other._it) {}
+
+        reference operator*() const noexcept { return _ptr ? *_ptr : *_it; }
+        pointer operator->() const noexcept { return std::addressof(**this); }
+
+        iterator_impl& operator++() noexcept {
+            if (_ptr) ++_ptr;
+            else ++_it;
+            return *this;
+        }
+
+        iterator_impl operator++(int) noexcept {
+            auto out = *this;
+            ++*this;
+            return out;
+        }
+
+        friend bool operator==(const iterator_impl &lhs, const iterator_impl &rhs) noexcept {
+            return lhs._ptr == rhs._ptr && lhs._it == rhs._it;
+        }
+
+    private:
+        friend class small_unordered_map;
+        template <bool> friend class iterator_impl;
+
+        ptr_type _ptr = nullptr;
+        map_iter _it;
+    };
+
+    using iterator       = iterator_impl<false>;
+    using const_iterator = iterator_impl<true>;
+
+
+    /*** Constructors and Destructors***/
+    small_unordered_map() = default;
+
+    explicit small_unordered_map(const Allocator &alloc) : _map(alloc) {}
+
+    small_unordered_map(std::initializer_list<value_type> ilist) {
+        for (const auto &kv : ilist)
+            insert(kv);
+    }
+
+    small_unordered_map(const small_unordered_map &other)
+    : _map(other._map), _inline_size(0), _spilled(other._spilled)
+    {
+        constructInline(other.inlineRange(), [](const value_type &kv) -> const value_type& { return kv; });
+    }
+
+    small_unordered_map(small_unordered_map &&other) noexcept(nothrow_move)
+    : _map(std::move(other._map)), _inline_size(0), _spilled(other._spilled)
+    {
+        constructInline(other.inlineRange(), [](value_type &kv) -> value_type&& { return std::move(kv); });
+
+        other.destroyInline();
+        other._spilled = false;
+    }
+
+    ~small_unordered_map() { destroyInline(); }
+
+    /*** Assignment operators ***/
+    // Copy-on-swap like My::vector
+    small_unordered_map &operator=(const small_unordered_map &other) {
+        small_unordered_map temp(other);
+        swap(temp);
+        return *this;
+    }
+
+    small_unordered_map &operator=(small_unordered_map &&other) noexcept(nothrow_move) {
+        small_unordered_map temp(std::move(other));
+        swap(temp);
+        return *this;
+    }
+
+    allocator_type get_allocator() const noexcept { return _map.get_allocator(); }
+
+    /*** Iterators ***/
+    iterator begin() noexcept {
+        return _spilled ? iterator(_map.begin()) : iterator(inlineData());
+    }
+    const_iterator begin() const noexcept {
+        return _spilled ? const_iterator(_map.begin()) : const_iterator(inlineData());
+    }
+    const_iterator cbegin() const noexcept { return begin(); }
+
+    iterator end() noexcept {
+        return _spilled ? iterator(_map.end()) : iterator(inlineData() + _inline_size);
+    }
+    const_iterator end() const noexcept {
+        return _spilled ? const_iterator(_map.end()) : const_iterator(inlineData() + _inline_size);
+    }
+    const_iterator cend() const noexcept { return end(); }
+
+    /*** Lookup ***/
+    T& at(const Key &key) { return const_cast<T&>(std::as_const(*this).at(key)); }
+    const T& at(const Key &key) const { return atHelper(key); }
+
+    template <class K> requires is_transparent<K>
+    T& at(const K &key) { return const_cast<T&>(atHelper(key)); }
+    template <class K> requires is_transparent<K>
+    const T& at(const K &key) const { return atHelper(key); }
+
+    T& operator[](const Key &key) { return try_emplace(key).first->second; }
+    T& operator[](Key &&key) { return try_emplace(std::move(key)).first->second; }
+
+    iterator find(const Key &key) { return findHelper<iterator>(*this, key); }
+    const_iterator find(const Key &key) const { return findHelper<const_iterator>(*this, key); }
+
+    template <class K> requires is_transparent<K>
+    iterator find(const K &key) { return findHelper<iterator>(*this, key); }
+    template <class K> requires is_transparent<K>
+    const_iterator find(const K &key) const { return findHelper<const_iterator>(*this, key); }
+
+    bool contains(const Key &key) const { return find(key) != end(); }
+    template <class K> requires is_transparent<K>
+    bool contains(const K &key) const { return find(key) != end(); }
+
+    size_type count(const Key &key) const { return contains(key); }
+    template <class K> requires is_transparent<K>
+    size_type count(const K &key) const { return contains(key); }
+
+    /*** Modifiers ***/
+    void clear() noexcept {
+        destroyInline();
+        _map.clear();
+    }
+
+    std::pair<iterator, bool> insert(const value_type &x) { return try_emplace(x.first, x.second); }
+    std::pair<iterator, bool> insert(value_type &&x) { return try_emplace(x.first, std::move(x.second)); }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const Key &key, Args&&... args) {
+        return tryEmplaceHelper(key, std::forward<Args>(args)...);
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(Key &&key, Args&&... args) {
+        return tryEmplaceHelper(std::move(key), std::forward<Args>(args)...);
+    }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const Key &key, M &&obj) {
+        auto res = try_emplace(key, std::forward<M>(obj));
+        if (!res.second)
+            res.first->second = std::forward<M>(obj);
+        return res;
+    }
+
+    template <class K, class V>
+    std::pair<iterator, bool> emplace(K &&key, V &&value) {
+        return tryEmplaceHelper(std::forward<K>(key), std::forward<V>(value));
+    }
+
+    iterator erase(const_iterator pos);
+    size_type erase(const Key &key) { return eraseHelper(key); }
+
+    template <class K>
+    requires (is_transparent<K> && !std::is_convertible_v<K&&, const_iterator>)
+    size_type erase(K &&key) { return eraseHelper(key); }
+
+    void swap(small_unordered_map &other) noexcept(nothrow_move) {
+        small_unordered_map temp(std::move(other));
+        other.moveFrom(*this);
+        moveFrom(temp);
+    }
+
+    /*** Capacity ***/
+    bool empty()     const noexcept { return !size(); }
+    size_type size() const noexcept { return _spilled ? _map.size() : _inline_size; }
+
+    // not defined in STL
+    bool is_small() const noexcept { return !_spilled; }
+    static constexpr size_type inline_capacity() noexcept { return N; }
+
+    // Going past N switches to the hashed map right away
+    void reserve(size_type count) {
+        if (count > N) {
+            spill();
+            _map.reserve(count);
+        }
+    }
+
+    /*** Hash policy ***/
+    // Only meaningful once the map has switched to hashed mode
+    size_type bucket_count() const { return _map.bucket_count(); }
+    hash_table_stats stats() const { return _map.stats(); }
+
+private:
+    map_type      _map;
+    size_type     _inline_size = 0;
+    bool          _spilled     = false;
+    [[no_unique_address]] key_equal _key_eq;
+    alignas(value_type) unsigned char _inline[N * sizeof(value_type)];
+
+    /*** Private helpers ***/
+    value_type* inlineData() noexcept {
+        return std::launder(reinterpret_cast<value_type*>(_inline));
+    }
+    const value_type* inlineData() const noexcept {
+        return std::launder(reinterpret_cast<const value_type*>(_inline));
+    }
+
+    std::span<value_type> inlineRange() noexcept { return {inlineData(), _inline_size}; }
+    std::span<const value_type> inlineRange() const noexcept { return {inlineData(), _inline_size}; }
+
+    void destroyInline() noexcept {
+        std::destroy_n(inlineData(), _inline_size);
+        _inline_size = 0;
+    }
+
+    // Constructs from's elements in the (empty) inline slots, on a throw the
+    // ones already made are destroyed again so nothing leaks
+    template <class Range, class Cast>
+    void constructInline(Range from, Cast cast) {
+        try {
+            for (auto &kv : from) {
+                std::construct_at(inlineData() + _inline_size, cast(kv));
+                ++_inline_size;
+            }
+        } catch (...) {
+            destroyInline();
+            throw;
+        }
+    }
+
+    // Leaves other empty, used by swap
+    void moveFrom(small_unordered_map &other) noexcept(nothrow_move) {
+        destroyInline();
+        _map = std::move(other._map);
+        _spilled = other._spilled;
+
+        constructInline(other.inlineRange(), [](value_type &kv) -> value_type&& { return std::move(kv); });
+
+        other.destroyInline();
+        other._spilled = false;
+    }
+
+    template <class K>
+    const value_type* inlineFind(const K &key) const {
+        for (const auto &kv : inlineRange())
+            if (_key_eq(kv.first, key))
+                return &kv;
+        return nullptr;
+    }
+
+    template <class It, class Self, class K>
+    static It findHelper(Self &self, const K &key) {
+        if (self._spilled)
+            return It(self._map.find(key));
+
+        if (auto p = self.inlineFind(key))
+            return It(const_cast<typename It::pointer>(p));
+
+        return self.end();
+    }
+
+    template <class K>
+    const T& atHelper(const K &key) const {
+        auto it = find(key);
+        if (it == end())
+            throw(std::out_of_range("No key found"));
+
+        return it->second;
+    }
+
+    // Keys are const inside the pairs so they're copied into the map, the
+    // mapped values are moved
+    void spill() {
+        if (_spilled)
+            return;
+
+        _map.reserve(N + 1);
+        for (auto &kv : inlineRange())
+            _map.try_emplace(kv.first, std::move(kv.second));
+
+        destroyInline();
+        _spilled = true;
+    }
+
+    template <class K, class... Args>
+    std::pair<iterator, bool> tryEmplaceHelper(K &&key, Args&&... args) {
+        if (!_spilled) {
+            if (auto p = inlineFind(key))
+                return {iterator(const_cast<value_type*>(p)), false};
+
+            if (_inline_size < N) {
+                value_type *slot = std::construct_at(inlineData() + _inline_size,
+                                                     std::piecewise_construct,
+                                                     std::forward_as_tuple(std::forward<K>(key)),
+                                                     std::forward_as_tuple(std::forward<Args>(args)...));
+                ++_inline_size;
+                return {iterator(slot), true};
+            }
+
+            spill();
+        }
+
+        auto [it, inserted] = _map.try_emplace(std::forward<K>(key), std::forward<Args>(args)...);
+        return {iterator(it), inserted};
+    }
+
+    // pair<const Key, T> can't be assigned, so the last element is rebuilt in the hole
+    void inlineErase(value_type *pos) {
+        value_type *last = inlineData() + _inline_size - 1;
+
+        std::destroy_at(pos);
+        if (pos != last) {
+            std::construct_at(pos, std::move(*last));
+            std::destroy_at(last);
+        }
+
+        --_inline_size;
+    }
+
+    template <class K>
+    size_type eraseHelper(const K &key) {
+        if (_spilled)
+            return _map.erase(key);
+
+        if (auto p = inlineFind(key)) {
+            inlineErase(const_cast<value_type*>(p));
+            return 1;
+        }
+
+        return 0;
+    }
+};
+
+template <typename Key, typename T, std::size_t N, typename Hash, typename KeyEqual, typename Allocator>
+typename small_unordered_map<Key, T, N, Hash, KeyEqual, Allocator>::iterator
+small_unordered_map<Key, T, N, Hash, KeyEqual, Allocator>::erase(const_iterator pos) {
+    if (_spilled)
+        return iterator(_map.erase(pos._it));
+
+    auto *p = const_cast<value_type*>(pos._ptr);
+    inlineErase(p);
+
+    // The old last element now sits at p, unless p was the last one
+    return iterator(p);
+}
+
+template <typename Key, typename T, std::size_t N, typename Hash, typename KeyEqual, typename Allocator>
+void swap(small_unordered_map<Key, T, N, Hash, KeyEqual, Allocator> &lhs,
+          small_unordered_map<Key, T, N, Hash, KeyEqual, Allocator> &rhs) noexcept(noexcept(lhs.swap(rhs))) {
+    lhs.swap(rhs);
+}
+
+} // namespace My
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+#include "my_vector.hpp"
+
+namespace My {
+
+/*
+ * vector with an inline buffer for the first N elements, not defined in STL
+ * (same idea as LLVM's SmallVector)
+ * It is a My::vector whose allocator carries the buffer: the first
+ * allocation of up to N elements is handed the inline buffer, anything
+ * bigger goes to the upstream allocator. So every vector member works as
+ * is, a push_back past N is a regular grow() onto the heap and
+ * shrink_to_fit() can come back inline.
+ *
+ * NOTE: the buffer lives in the object so the element storage can't just be
+ *       stolen when it's inline. small_vector has its own copy/move/swap for
+ *       that, don't slice it down to My::vector and move/swap the base
+ */
+
+template <class T, std::size_t N, class Upstream = std::allocator<T>>
+class inline_allocator {
+    using __up_traits = std::allocator_traits<Upstream>;
+
+public:
+    using value_type      = T;
+    using size_type       = typename __up_traits::size_type;
+    using difference_type = typename __up_traits::difference_type;
+
+    // The buffer never changes hands between containers
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::false_type;
+    using propagate_on_container_swap            = std::false_type;
+    using is_always_equal                        = std::false_type;
+
+    template <class U>
+    struct rebind {
+        using other = inline_allocator<U, N, typename __up_traits::template rebind_alloc<U>>;
+    };
+
+    inline_allocator() = default;
+    explicit inline_allocator(const Upstream &upstream) : _upstream(upstream) {}
+
+    // Copies only share the upstream, each one has its own (unused) buffer
+    inline_allocator(const inline_allocator &other) : _upstream(other._upstream) {}
+    inline_allocator &operator=(const inline_allocator &other) {
+        _upstream = other._upstream;
+        return *this;
+    }
+
+    T* allocate(size_type n) {
+        if (!_used && n <= N) {
+            _used = true;
+            return buffer();
+        }
+
+        return __up_traits::allocate(_upstream, n);
+    }
+
+    void deallocate(T *p, size_type n) {
+        if (p == buffer())
+            _used = false;
+        else if (p)
+            __up_traits::deallocate(_upstream, p, n);
+    }
+
+    T* buffer() noexcept { return reinterpret_cast<T*>(_buf); }
+    const T* buffer() const noexcept { return reinterpret_cast<const T*>(_buf); }
+    const Upstream& upstream() const noexcept { return _upstream; }
+
+    // Only the same object can free the inline buffer
+    friend bool operator==(const inline_allocator &lhs, const inline_allocator &rhs) noexcept {
+        return &lhs == &rhs;
+    }
+
+private:
+    [[no_unique_address]] Upstream _upstream;
+    bool _used = false;
+    alignas(T) unsigned char _buf[N * sizeof(T)];
+};
+
+template <class T, std::size_t N, class Allocator = std::allocator<T>>
+class small_vector : public vector<T, inline_allocator<T, N, Allocator>> {
+    static_assert(N > 0, "Use My::vector directly for N == 0");
+
+    using base = vector<T, inline_allocator<T, N, Allocator>>;
+
+public:
+    using typename base::value_type;
+    using typename base::size_type;
+    using typename base::allocator_type;
+    using typename base::pointer;
+    using typename base::iterator;
+    using typename base::const_iterator;
+
+
+    /*** Constructors and Destructors***/
+    // Starts out pointing at the inline buffer with capacity N
+    small_vector() { takeInline(); }
+
+    explicit small_vector(const Allocator &upstream)
+    : base(allocator_type(upstream))
+    { takeInline(); }
+
+    small_vector(size_type count, const T &value) : small_vector() { this->assign(count, value); }
+
+    template <class InputIt,
+              class Enable = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+    small_vector(InputIt first, InputIt last) : small_vector() { this->assign(first, last); }
+
+    small_vector(std::initializer_list<T> init) : small_vector() { this->assign(init); }
+
+    small_vector(const small_vector &other)
+    : base(allocator_type(other.allocator_.upstream()))
+    {
+        takeInline();
+        this->assign(other.begin(), other.end());
+    }
+
+    small_vector(small_vector &&other) noexcept(std::is_nothrow_move_constructible_v<T>)
+    : base(allocator_type(other.allocator_.upstream()))
+    {
+        takeInline();
+        moveFrom(other);
+    }
+
+    /*** Assignment operators ***/
+    small_vector &operator=(const small_vector &other) {
+        if (this != &other)
+            this->assign(other.begin(), other.end());
+        return *this;
+    }
+
+    small_vector &operator=(small_vector &&other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        if (this != &other) {
+            release();
+            takeInline();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    small_vector &operator=(std::initializer_list<T> ilist) {
+        this->assign(ilist);
+        return *this;
+    }
+
+    /*** Capacity ***/
+    // not defined in STL
+    bool is_small() const noexcept {
+        return this->data_ == this->allocator_.buffer();
+    }
+    static constexpr size_type inline_capacity() noexcept { return N; }
+
+    // Goes back to the inline buffer if everything fits in it again
+    void shrink_to_fit() {
+        if (is_small())
+            return;
+
+        if (this->size_ <= N)
+            this->grow(N);
+        else
+            base::shrink_to_fit();
+    }
+
+    /*** Modifiers ***/
+    // Two heap buffers just trade pointers, otherwise the elements are moved
+    void swap(small_vector &other) {
+        if (!is_small() && !other.is_small()
+            && this->allocator_.upstream() == other.allocator_.upstream()) {
+            std::swap(this->data_, other.data_);
+            std::swap(this->size_, other.size_);
+            std::swap(this->capacity_, other.capacity_);
+            return;
+        }
+
+        small_vector temp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(temp);
+    }
+
+private:
+    void takeInline() {
+        this->data_ = this->allocator_.allocate(N);
+        this->capacity_ = N;
+    }
+
+    // Destroys everything and frees the heap buffer, if any
+    void release() {
+        this->clear();
+        this->allocator_.deallocate(this->data_, this->capacity_);
+        this->data_ = nullptr;
+        this->capacity_ = 0;
+    }
+
+    // Expects *this to be empty and inline, leaves other empty and inline
+    void moveFrom(small_vector &other) {
+        if (!other.is_small() && this->allocator_.upstream() == other.allocator_.upstream()) {
+            this->allocator_.deallocate(this->data_, this->capacity_);
+            this->data_ = other.data_;
+            this->size_ = other.size_;
+            this->capacity_ = other.capacity_;
+
+            other.data_ = nullptr;
+            other.size_ = other.capacity_ = 0;
+            other.takeInline();
+            return;
+        }
+
+        this->reserve(other.size_);
+        uninitialized_relocate(this->allocator_, other.data_, other.size_, this->data_);
+        this->size_ = other.size_;
+        other.size_ = 0;
+
+        // A heap buffer that couldn't be taken over goes back upstream
+        if (!other.is_small()) {
+            other.allocator_.deallocate(other.data_, other.capacity_);
+            other.takeInline();
+        }
+    }
+};
+
+template <class T, std::size_t N, class Allocator>
+void swap(small_vector<T, N, Allocator> &lhs, small_vector<T, N, Allocator> &rhs) {
+    lhs.swap(rhs);
+}
+
+} // namespace My
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+namespace My {
+
+/*
+ * Work stealing thread pool, not defined in STL
+ * Every worker has its own deque: it pushes and pops its own tasks at the
+ * back (newest first, still hot in cache) and, when it runs out, steals from
+ * the front of someone else's (oldest first, which for divide and conquer is
+ * the biggest piece left). Tasks submitted from outside the pool are spread
+ * round robin over the deques.
+ *
+ * task_group is the fork/join part: run() forks, wait() joins, and while
+ * waiting the calling thread runs pending tasks itself. So a task can fork
+ * and wait on subtasks without tying up a worker, and nested parallelism
+ * can't deadlock the pool.
+ *
+ *   My::task_group group(pool);
+ *   group.run([&] { left(); });
+ *   right();
+ *   group.wait();   // rethrows the first exception a task threw
+ *
+ * NOTE: each deque is a mutex + std::deque rather than a lock free
+ *       Chase-Lev deque. Tasks here are chunks of thousands of elements, so
+ *       the lock is nowhere near the bottleneck
+ */
+
+class thread_pool {
+public:
+    using task = std::move_only_function<void()>;
+
+    explicit thread_pool(unsigned threads = std::max(1u, std::thread::hardware_concurrency()))
+    : _queues(std::max(1u, threads))
+    {
+        _threads.reserve(_queues.size());
+        for (unsigned i = 0; i < _queues.size(); ++i)
+            _threads.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool &operator=(const thread_pool&) = delete;
+
+    // Runs whatever is still queued, then joins
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(_sleep_mutex);
+            _stop = true;
+        }
+        _wake.notify_all();
+
+        for (auto &t : _threads)
+            t.join();
+    }
+
+    unsigned size() const noexcept { return static_cast<unsigned>(_queues.size()); }
+
+    // Fire and forget, see task_group to wait on it
+    void submit(task t) {
+        const std::size_t idx = tls_pool == this
+                              ? tls_index
+                              : _next_queue.fetch_add(1, std::memory_order_relaxed) % _queues.size();
+        {
+            std::lock_guard<std::mutex> lock(_queues[idx].mutex);
+            _queues[idx].tasks.push_back(std::move(t));
+        }
+
+        _queued.fetch_add(1, std::memory_order_release);
+        {
+            // Pairs with the wait in workerLoop so the wakeup can't slip in
+            // between a worker's check and its sleep
+            std::lock_guard<std::mutex> lock(_sleep_mutex);
+        }
+        _wake.notify_one();
+    }
+
+    // Runs one queued task on the calling thread, false if there was none
+    bool try_run_one() {
+        const std::size_t self = tls_pool == this ? tls_index : 0;
+
+        task t;
+        if (!grab(self, t))
+            return false;
+
+        t();
+        return true;
+    }
+
+    // True when called from one of this pool's workers
+    bool in_worker() const noexcept { return tls_pool == this; }
+
+    // Shared pool with one thread per core, built on first use
+    static thread_pool& global() {
+        static thread_pool pool;
+        return pool;
+    }
+
+private:
+    struct alignas(64) queue {
+        std::mutex       mutex;
+        std::deque<task> tasks;
+    };
+
+    std::vector<queue>       _queues;
+    std::vector<std::thread> _threads;
+
+    std::atomic<std::size_t> _queued{0};
+    std::atomic<std::size_t> _next_queue{0};
+
+    std::mutex               _sleep_mutex;
+    std::condition_variable  _wake;
+    bool                     _stop = false;
+
+    static inline thread_local thread_pool *tls_pool  = nullptr;
+    static inline thread_local std::size_t  tls_index = 0;
+
+    // Own deque from the back, then everyone else's from the front
+    bool grab(std::size_t self, task &out) {
+        if (!_queued.load(std::memory_order_acquire))
+            return false;
+
+        {
+            auto &own = _queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                out = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                _queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        for (std::size_t i = 1; i < _queues.size(); ++i) {
+            auto &victim = _queues[(self + i) % _queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                out = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                _queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void workerLoop(std::size_t idx) {
+        tls_pool = this;
+        tls_index = idx;
+
+        for (;;) {
+            task t;
+            if (grab(idx, t)) {
+                t();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(_sleep_mutex);
+            _wake.wait(lock, [this] {
+                return _stop || _queued.load(std::memory_order_acquire);
+            });
+
+            if (_stop && !_queued.load(std::memory_order_acquire))
+                return;
+        }
+    }
+};
+
+class task_group {
+public:
+    explicit task_group(thread_pool &pool = thread_pool::global()) : _pool(pool) {}
+
+    task_group(const task_group&) = delete;
+    task_group &operator=(const task_group&) = delete;
+
+    // Tasks capture by reference all the time, so never leave them running
+    ~task_group() { waitNoThrow(); }
+
+    template <class F>
+    void run(F &&f) {
+        _pending.fetch_add(1, std::memory_order_relaxed);
+        _pool.submit([this, f = std::forward<F>(f)]() mutable {
+            try {
+                f();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(_error_mutex);
+                if (!_error)
+                    _error = std::current_exception();
+            }
+            _pending.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    // Helps run queued tasks until every task of this group is done
+    void wait() {
+        waitNoThrow();
+
+        if (_error) {
+            auto e = std::exchange(_error, nullptr);
+            std::rethrow_exception(e);
+        }
+    }
+
+private:
+    thread_pool               &_pool;
+    std::atomic<std::size_t>   _pending{0};
+    std::mutex                 _error_mutex;
+    std::exception_ptr         _error;
+
+    void waitNoThrow() noexcept {
+        while (_pending.load(std::memory_order_acquire))
+            if (!_pool.try_run_one())
+                std::this_thread::yield();
+    }
+};
+
+} // namespace My
@@ -0,0 +1,327 @@
+#pragma once
+
+#include <bits/stdc++.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+namespace My {
+
+/*
+ * Cheap timestamps and scoped trace spans, not defined in STL
+ *
+ * tsc_clock reads the CPU's time stamp counter (rdtsc, no syscall or vDSO)
+ * instead of going through clock_gettime like curr_time() in util.hpp. The
+ * tick rate is measured against steady_clock the first time it's used. When
+ * the TSC isn't invariant (its rate follows the core's frequency, or it
+ * stops in sleep states) or this isn't x86, it's steady_clock in nanoseconds.
+ *
+ * Spans record the name, start and end of a scope:
+ *
+ *   void OrderBook::addOrder(Order o) {
+ *       MY_TRACE_SPAN("addOrder");
+ *       ...
+ *   }
+ *
+ *   My::trace::set_thread_name("matcher");
+ *   ...
+ *   My::trace::write_chrome_json("trace.json");   // open in chrome://tracing or ui.perfetto.dev
+ *
+ * Every thread writes its spans into its own ring buffer, so recording is two
+ * rdtsc and four plain stores with no locks or RMW. When a buffer is full the
+ * oldest spans are overwritten. When a thread exits its buffer goes back to
+ * a free list (like the records in my_epoch.hpp) and the next new thread
+ * takes it over, so threads that come and go don't pile up buffers. The
+ * exited thread's spans can be dumped until then.
+ * Build with -DMY_NO_TRACE and MY_TRACE_SPAN compiles to nothing.
+ *
+ * NOTE: span names must outlive the dump (string literals). Dumping while
+ *       threads are still tracing skips the spans being overwritten
+ */
+
+class tsc_clock {
+public:
+    // Raw ticks, only differences mean anything
+    static std::uint64_t now() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        if (calibration().invariant) [[likely]]
+            return __rdtsc();
+#endif
+        return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+
+    static double to_ns(std::uint64_t ticks) noexcept { return ticks * calibration().ns_per_tick; }
+
+    static double ticks_per_ns() noexcept { return 1 / calibration().ns_per_tick; }
+    static bool invariant() noexcept { return calibration().invariant; }
+
+    // Ticks at calibration, for timestamps relative to program start
+    static std::uint64_t origin() noexcept { return calibration().origin; }
+
+private:
+    struct calibration_data {
+        bool          invariant   = false;
+        double        ns_per_tick = 1;
+        std::uint64_t origin      = 0;
+    };
+
+    static bool hasInvariantTsc() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+            return false;
+        __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+        return edx & (1u << 8);
+#else
+        return false;
+#endif
+    }
+
+    // Counts ticks over ~10ms of steady_clock, long enough that the two
+    // clock reads at each end are noise
+    static calibration_data calibrate() noexcept {
+        calibration_data out;
+        out.invariant = hasInvariantTsc();
+
+#if defined(__x86_64__) || defined(__i386__)
+        if (out.invariant) {
+            using std::chrono::steady_clock;
+            const auto t0 = steady_clock::now();
+            const std::uint64_t c0 = __rdtsc();
+            while (steady_clock::now() - t0 < std::chrono::milliseconds(10)) {}
+            const auto t1 = steady_clock::now();
+            const std::uint64_t c1 = __rdtsc();
+
+            const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+            out.ns_per_tick = ns / static_cast<double>(c1 - c0);
+            out.origin = c0;
+            return out;
+        }
+#endif
+        out.origin = static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        return out;
+    }
+
+    static const calibration_data& calibration() noexcept {
+        static const calibration_data data = calibrate();
+        return data;
+    }
+};
+
+namespace trace {
+
+// Spans kept per thread, older ones get overwritten
+inline constexpr std::size_t buffer_spans = 1 << 16;
+
+namespace detail {
+
+// Relaxed atomics so a dump racing a writer is torn, not undefined. They
+// compile to plain movs
+struct span_record {
+    std::atomic<const char*>   name{nullptr};
+    std::atomic<std::uint64_t> start{0};
+    std::atomic<std::uint64_t> end{0};
+};
+
+struct thread_buffer {
+    std::vector<span_record>   spans = std::vector<span_record>(buffer_spans);
+    std::atomic<std::uint64_t> head{0};              // Spans ever written, never goes back
+    std::atomic<std::uint64_t> first{0};             // Spans before this were cleared
+    bool                       in_use = true;        // Guarded by registryMutex()
+
+    // Guarded by name_mutex, they change when another thread takes the buffer over
+    std::uint32_t              tid = 0;
+    std::string                name;
+    std::mutex                 name_mutex;
+
+    void push(const char *n, std::uint64_t start, std::uint64_t end) noexcept {
+        const std::uint64_t h = head.load(std::memory_order_relaxed);
+        // Keeps the previous head bump ahead of overwriting the slot, so a
+        // dump that reads the new fields also sees head past the old span
+        std::atomic_thread_fence(std::memory_order_release);
+        span_record &r = spans[h & (buffer_spans - 1)];
+        r.name.store(n, std::memory_order_relaxed);
+        r.start.store(start, std::memory_order_relaxed);
+        r.end.store(end, std::memory_order_relaxed);
+        head.store(h + 1, std::memory_order_release);
+    }
+};
+
+inline std::mutex &registryMutex() {
+    static std::mutex m;
+    return m;
+}
+
+// Buffers are never freed, only reused, so the dump can hold plain pointers.
+// Never destroyed either, a thread may still trace during static destruction
+inline std::vector<thread_buffer*> &registry() {
+    static auto *buffers = new std::vector<thread_buffer*>;
+    return *buffers;
+}
+
+// Takes a buffer a finished thread left behind, or makes a new one
+inline thread_buffer *acquireBuffer() {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    static std::uint32_t next_tid = 0;
+
+    thread_buffer *buf = nullptr;
+    for (thread_buffer *b : registry()) {
+        if (!b->in_use) {
+            buf = b;
+            break;
+        }
+    }
+    if (!buf) {
+        buf = new thread_buffer;
+        registry().push_back(buf);
+    }
+
+    buf->in_use = true;
+    buf->first.store(buf->head.load(std::memory_order_relaxed), std::memory_order_release);
+    std::lock_guard<std::mutex> name_lock(buf->name_mutex);
+    buf->tid = ++next_tid;
+    buf->name.clear();
+    return buf;
+}
+
+// Hands the buffer back when its thread exits
+struct buffer_owner {
+    thread_buffer *buf = acquireBuffer();
+
+    ~buffer_owner() {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        buf->in_use = false;
+    }
+};
+
+inline thread_buffer &localBuffer() {
+    static thread_local buffer_owner owner;
+    return *owner.buf;
+}
+
+inline void jsonString(std::ostream &os, std::string_view s) {
+    os << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            os << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            os << ' ';
+        else
+            os << c;
+    }
+    os << '"';
+}
+
+} // namespace detail
+
+// Shows up as the thread's name in the trace viewer
+inline void set_thread_name(std::string name) {
+    auto &buf = detail::localBuffer();
+    std::lock_guard<std::mutex> lock(buf.name_mutex);
+    buf.name = std::move(name);
+}
+
+// Records one span, for when the start and end aren't in one scope
+inline void record(const char *name, std::uint64_t startTicks, std::uint64_t endTicks) noexcept {
+    detail::localBuffer().push(name, startTicks, endTicks);
+}
+
+class span {
+public:
+    explicit span(const char *name) noexcept : _name(name), _start(tsc_clock::now()) {}
+    ~span() { record(_name, _start, tsc_clock::now()); }
+
+    span(const span&) = delete;
+    span &operator=(const span&) = delete;
+
+private:
+    const char    *_name;
+    std::uint64_t  _start;
+};
+
+// Every span still in the buffers as Chrome trace event JSON ("X" complete
+// events, microseconds since the clock was calibrated)
+inline void write_chrome_json(std::ostream &os) {
+    std::vector<detail::thread_buffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(detail::registryMutex());
+        buffers = detail::registry();
+    }
+
+    const std::uint64_t origin = tsc_clock::origin();
+    auto micros = [origin](std::uint64_t ticks) {
+        return ticks >= origin ? tsc_clock::to_ns(ticks - origin) / 1000 : 0.0;
+    };
+
+    os << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+    bool first = true;
+    auto sep = [&] { os << (first ? "" : ",\n"); first = false; };
+
+    os << std::fixed << std::setprecision(3);
+    for (detail::thread_buffer *buf : buffers) {
+        std::uint32_t tid;
+        {
+            std::lock_guard<std::mutex> lock(buf->name_mutex);
+            tid = buf->tid;
+            if (!buf->name.empty()) {
+                sep();
+                os << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": " << tid
+                   << ", \"args\": {\"name\": ";
+                detail::jsonString(os, buf->name);
+                os << "}}";
+            }
+        }
+
+        const std::uint64_t head = buf->head.load(std::memory_order_acquire);
+        const std::uint64_t first = buf->first.load(std::memory_order_acquire);
+        const std::uint64_t from = std::max(first, head > buffer_spans ? head - buffer_spans : 0);
+        for (std::uint64_t i = from; i < head; ++i) {
+            const auto &r = buf->spans[i & (buffer_spans - 1)];
+            const char *name = r.name.load(std::memory_order_relaxed);
+            const std::uint64_t start = r.start.load(std::memory_order_relaxed);
+            const std::uint64_t end = r.end.load(std::memory_order_relaxed);
+
+            // The writer has lapped this slot (or is writing it) since head
+            // was read, what we copied may be half the newer span
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (i + buffer_spans <= buf->head.load(std::memory_order_relaxed) || !name)
+                continue;
+
+            sep();
+            os << "{\"ph\": \"X\", \"name\": ";
+            detail::jsonString(os, name);
+            os << ", \"pid\": 1, \"tid\": " << tid << ", \"ts\": " << micros(start)
+               << ", \"dur\": " << tsc_clock::to_ns(end - start) / 1000 << "}";
+        }
+    }
+    os << "\n]}\n";
+}
+
+inline void write_chrome_json(const std::string &path) {
+    std::ofstream os(path);
+    if (!os)
+        throw(std::runtime_error("trace: can't write " + path));
+    write_chrome_json(os);
+}
+
+// Drops every recorded span (thread names stay). head keeps counting, so a
+// thread tracing meanwhile just carries on
+inline void clear() {
+    std::lock_guard<std::mutex> lock(detail::registryMutex());
+    for (detail::thread_buffer *buf : detail::registry())
+        buf->first.store(buf->head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+} // namespace trace
+
+} // namespace My
+
+#define MY_TRACE_CONCAT_(a, b) a##b
+#define MY_TRACE_CONCAT(a, b) MY_TRACE_CONCAT_(a, b)
+
+#ifdef MY_NO_TRACE
+#define MY_TRACE_SPAN(name) static_cast<void>(0)
+#else
+#define MY_TRACE_SPAN(name) ::My::trace::span MY_TRACE_CONCAT(my_trace_span_, __LINE__)(name)
+#endif
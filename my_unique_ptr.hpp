@@ -3,6 +3,13 @@
 
 namespace My {
 
+/*
+ * My (custom) implementation of C++'s unique_ptr
+ * https://en.cppreference.com/w/cpp/memory/unique_ptr.html
+ * The deleter is [[no_unique_address]], so with an empty one (default_delete,
+ * pool_delete, a captureless lambda) a unique_ptr is exactly a raw pointer
+ */
+
 template <class T, class Deleter = std::default_delete<T>>
 class unique_ptr {
 public:
@@ -98,11 +105,106 @@ public:
     pointer operator->() const noexcept { return __ptr; }
 
 private:
-    pointer __ptr;
-    Deleter __del;
- 
+    pointer                       __ptr;
+    [[no_unique_address]] Deleter __del;
 };
 
+// Array version, operator[] in place of * and ->, and no conversions from
+// pointers to a derived type (delete[] through a base pointer is UB)
+template <class T, class Deleter>
+class unique_ptr<T[], Deleter> {
+public:
+    using element_type = T;
+    using deleter_type = Deleter;
+    using pointer = T*;
+
+
+    // Constructors
+    constexpr unique_ptr() noexcept
+    : __ptr(nullptr), __del() {}
+
+    constexpr unique_ptr(std::nullptr_t) noexcept
+    : __ptr(nullptr), __del() {}
+
+    explicit unique_ptr(pointer p) noexcept
+    : __ptr(p), __del() {}
+
+    unique_ptr(pointer p, const Deleter& d) noexcept
+    : __ptr(p), __del(d) {}
+
+    unique_ptr(pointer p, Deleter&& d) noexcept
+    : __ptr(p), __del(std::move(d)) {}
+
+
+    // Move ctors
+    unique_ptr(unique_ptr &&u) noexcept
+    : __ptr(u.release()), __del(std::move(u.__del)) {}
+
+    unique_ptr(const unique_ptr &) = delete;
+
+    ~unique_ptr() {
+        if (__ptr)
+            __del(__ptr);
+    }
+
+
+    // Assignment
+    unique_ptr& operator=(unique_ptr &&r) noexcept {
+        if (this == &r) return *this;
+
+        reset(r.release());
+        __del = std::move(r.__del);
+        return *this;
+    }
+
+    unique_ptr& operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    unique_ptr& operator=(const unique_ptr&) = delete;
+
+
+    // Modifiers
+    pointer release() noexcept {
+        auto out = __ptr;
+        __ptr = nullptr;
+        return out;
+    }
+
+    void reset(pointer ptr = pointer()) noexcept {
+        if (__ptr && ptr != __ptr)
+            __del(__ptr);
+
+        __ptr = ptr;
+    }
+
+    void reset(std::nullptr_t) noexcept { reset(pointer()); }
+
+    void swap(unique_ptr &other) noexcept {
+        std::swap(__ptr, other.__ptr);
+        std::swap(__del, other.__del);
+    }
+
+
+    /*** Observers ***/
+    pointer get() const noexcept { return __ptr; }
+    Deleter& get_deleter() noexcept { return __del; }
+    const Deleter& get_deleter() const noexcept { return __del; }
+    explicit operator bool() const noexcept { return __ptr; }
+
+    T& operator[](std::size_t i) const noexcept { return __ptr[i]; }
+
+private:
+    pointer                       __ptr;
+    [[no_unique_address]] Deleter __del;
+};
+
+template <class T, class D>
+void swap(unique_ptr<T, D> &lhs, unique_ptr<T, D> &rhs) noexcept {
+    lhs.swap(rhs);
+}
+
 template<typename T1, typename T2>
 bool operator==(My::unique_ptr<T1>& lhs, My::unique_ptr<T2>& rhs){
     return lhs.get() == rhs.get();
@@ -131,10 +233,35 @@ make_unique(Args&&... args) {
     return unique_ptr<T>(new T(std::forward<Args>(args)...));
 }
 
+// make_unique<T[]>(n), elements are value initialized (zeroed for scalars)
+template <class T>
+std::enable_if_t<std::is_unbounded_array_v<T>, unique_ptr<T>>
+make_unique(std::size_t n) {
+    return unique_ptr<T>(new std::remove_extent_t<T>[n]());
+}
+
 template <class T, class... Args>
-std::enable_if_t<std::is_array<T>::value, unique_ptr<T>>
+std::enable_if_t<std::is_bounded_array_v<T>>
 make_unique(Args&&...) = delete;
 
+// Default initialized, so scalars and trivial types are left as they are
+// instead of being zeroed, for buffers that are about to be written anyway
+template <class T>
+std::enable_if_t<!std::is_array_v<T>, unique_ptr<T>>
+make_unique_for_overwrite() {
+    return unique_ptr<T>(new T);
+}
+
+template <class T>
+std::enable_if_t<std::is_unbounded_array_v<T>, unique_ptr<T>>
+make_unique_for_overwrite(std::size_t n) {
+    return unique_ptr<T>(new std::remove_extent_t<T>[n]);
+}
+
+template <class T, class... Args>
+std::enable_if_t<std::is_bounded_array_v<T>>
+make_unique_for_overwrite(Args&&...) = delete;
+
 
 
 int test(){
@@ -226,6 +353,34 @@ int test(){
         std::cout << "Test 8 passed\n";
     }
 
+    {
+        /* Empty deleters take no space */
+        static_assert(sizeof(My::unique_ptr<int>) == sizeof(int*));
+        static_assert(sizeof(My::unique_ptr<int[]>) == sizeof(int*));
+
+        auto del = [](int *p) { delete p; };
+        static_assert(sizeof(My::unique_ptr<int, decltype(del)>) == sizeof(int*));
+        std::cout << "Test 9 passed\n";
+    }
+
+    {
+        /* Arrays, make_unique zeroes them */
+        auto arr = My::make_unique<int[]>(5);
+        for (int i = 0; i < 5; ++i)
+            assert(arr[i] == 0);
+
+        arr[2] = 7;
+        assert(arr.get()[2] == 7);
+
+        auto buf = My::make_unique_for_overwrite<char[]>(64);
+        buf[0] = 'x';
+        assert(buf[0] == 'x');
+
+        arr.reset();
+        assert(!arr);
+        std::cout << "Test 10 passed\n";
+    }
+
     return 0;
 }
 
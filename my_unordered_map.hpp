@@ -6,6 +6,9 @@
 #include <memory>
 #include <string>
 
+#include "my_hash.hpp"
+#include "my_instrument.hpp"
+
 namespace My {
 
 /*
@@ -22,6 +25,7 @@ namespace My {
  */
 
 constexpr std::size_t default_resize = 2; // Size of backing array after first resize
+constexpr std::size_t growth_factor  = 2; // Bucket count multiplier when the load factor is exceeded
 
 static constexpr std::array<int, 170> primes = {
     2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71,
@@ -81,9 +85,104 @@ static constexpr std::array<int, 170> primes = {
     throw std::overflow_error("nextPrime: no prime exists in int range");
 }
 
+constexpr std::size_t lookup_sample_rate = 64; // 1 in N lookups records its probe count
+constexpr std::size_t stats_histogram_size = 8; // Chains this long or longer share the last slot
+
+// Snapshot returned by unordered_map::stats(), not defined in STL
+// Probe counts are only recorded for a sample of lookups so find() stays cheap
+struct hash_table_stats {
+    std::size_t size            = 0;
+    std::size_t bucket_count    = 0;
+    std::size_t empty_buckets   = 0;
+    std::size_t max_chain       = 0;
+    double      mean_chain      = 0; // Over non empty buckets, ~1 for a good hash
+    float       load_factor     = 0;
+    std::size_t rehash_count    = 0;
+    std::size_t bytes_allocated = 0; // Bucket array + nodes
+
+    std::size_t sampled_lookups = 0;
+    std::size_t sampled_probes  = 0; // Key comparisons done by the sampled lookups
+
+    // chain_histogram[i] is the number of buckets holding i elements
+    std::array<std::size_t, stats_histogram_size> chain_histogram{};
+
+    double mean_probes() const {
+        return sampled_lookups ? double(sampled_probes) / sampled_lookups : 0;
+    }
+};
+
+// Heterogeneous lookup is opt-in through is_transparent, same as the STL
+template <class Hash, class KeyEqual>
+concept transparent_lookup = requires {
+    typename Hash::is_transparent;
+    typename KeyEqual::is_transparent;
+};
+
+template <class P> constexpr bool is_pair_like = false;
+template <class A, class B> constexpr bool is_pair_like<std::pair<A, B>> = true;
+
+/*** Nodes ***/
+// Every element of the map lives in one singly linked list, the links are
+// kept in a base so the map can own a sentinel "before begin" node
+struct hash_node_base {
+    hash_node_base *next = nullptr;
+};
+
+// The hash is cached so rehashing and mismatches never call the hasher again
+// The value sits in raw storage so a node can be allocated before it's built
+template <class V>
+struct hash_node : hash_node_base {
+    std::size_t hash;
+    alignas(V) unsigned char storage[sizeof(V)];
+
+    void* raw() noexcept { return storage; }
+    V& value() noexcept { return *std::launder(reinterpret_cast<V*>(storage)); }
+};
+
+template <class V, bool Const>
+class hash_map_iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = V;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = std::conditional_t<Const, const V*, V*>;
+    using reference         = std::conditional_t<Const, const V&, V&>;
+
+    hash_map_iterator() noexcept = default;
+    explicit hash_map_iterator(hash_node_base *node) noexcept : _node(node) {}
+
+    // iterator -> const_iterator
+    template <bool C = Const, std::enable_if_t<C, int> = 0>
+    hash_map_iterator(const hash_map_iterator<V, false> &other) noexcept : _node(other._node) {}
+
+    reference operator*() const noexcept { return static_cast<hash_node<V>*>(_node)->value(); }
+    pointer operator->() const noexcept { return std::addressof(**this); }
+
+    hash_map_iterator& operator++() noexcept {
+        _node = _node->next;
+        return *this;
+    }
+
+    hash_map_iterator operator++(int) noexcept {
+        auto out = *this;
+        ++*this;
+        return out;
+    }
+
+    friend bool operator==(const hash_map_iterator &lhs, const hash_map_iterator &rhs) noexcept {
+        return lhs._node == rhs._node;
+    }
+
+private:
+    template <class, bool> friend class hash_map_iterator;
+    template <class, class, class, class, class> friend class unordered_map;
+
+    hash_node_base *_node = nullptr;
+};
+
 template <typename Key,
           typename T,
-          typename Hash      = std::hash<Key>,
+          typename Hash      = My::hash<Key>,
           typename KeyEqual  = std::equal_to<Key>,
           typename Allocator = std::allocator<std::pair<const Key, T>>>
 class unordered_map {
@@ -96,7 +195,7 @@ public:
     using hasher          = Hash;
     using key_equal       = KeyEqual;
     using allocator_type  = Allocator;
-    using __alloc_traits  = std::allocator_traits<allocator_type>;
+    using __alloc_traits  = instrument::traits_for<allocator_type>;
 
     using size_type       = typename __alloc_traits::size_type;
     using difference_type = typename __alloc_traits::difference_type;
@@ -106,12 +205,26 @@ public:
 
     using pointer         = typename __alloc_traits::pointer;
     using const_pointer   = typename __alloc_traits::const_pointer;
-    using iterator        = pointer;
-    using const_iterator  = const_pointer;
+    using iterator        = hash_map_iterator<value_type, false>;
+    using const_iterator  = hash_map_iterator<value_type, true>;
 
     static_assert((std::is_same<typename allocator_type::value_type, value_type>::value),
                   "Allocator::value_type must be same type as value_type");
 
+private:
+    // Dependent on K so the heterogeneous overloads drop out instead of failing
+    template <class K>
+    static constexpr bool is_transparent = transparent_lookup<Hash, KeyEqual>;
+
+    using node_type      = hash_node<value_type>;
+    using node_allocator = typename __alloc_traits::template rebind_alloc<node_type>;
+    using node_traits    = instrument::traits_for<node_allocator, value_type>;
+
+    // The bucket array goes through the allocator too so an arena owns all of it
+    using bucket_allocator = typename __alloc_traits::template rebind_alloc<hash_node_base*>;
+    using bucket_traits    = instrument::traits_for<bucket_allocator, value_type>;
+
+public:
 
     /*** Constructors and Destructors***/
     // Default constructors, sets _max_load_factor() to 1.0
@@ -150,73 +263,204 @@ public:
 
     // Copy constructor
     unordered_map(const unordered_map &other) 
-        : unordered_map(other, std::allocator_traits<allocator_type>::select_on_container_copy_construction(other.get_allocator())) {};
+        : unordered_map(other, __alloc_traits::select_on_container_copy_construction(other.get_allocator())) {};
     unordered_map(const unordered_map &other, const Allocator &alloc);
 
-    // TODO: Destructor looks good but need to check
-    ~unordered_map() = default;
+    // Move constructor, the buckets and nodes are stolen as is
+    unordered_map(unordered_map &&other) noexcept;
+    // Only steals if alloc can free other's memory, otherwise moves element by element
+    unordered_map(unordered_map &&other, const Allocator &alloc);
 
-    allocator_type get_allocator() const noexcept { return _allocator; }
+    ~unordered_map() {
+        destroyNodes(_before_begin.next);
+        deallocateBuckets();
+    }
+
+    /*** Assignment operators ***/
+    // Copy-on-swap like My::vector, the allocator only follows the elements
+    // if the allocator says it propagates (an arena allocator doesn't)
+    unordered_map &operator=(const unordered_map &other) {
+        constexpr bool propagate = node_traits::propagate_on_container_copy_assignment::value;
+        unordered_map temp(other, propagate ? other.get_allocator() : get_allocator());
+        swapAll(temp);
+        return *this;
+    }
+
+    unordered_map &operator=(unordered_map &&other)
+        noexcept(node_traits::propagate_on_container_move_assignment::value
+                 || node_traits::is_always_equal::value) {
+        constexpr bool propagate = node_traits::propagate_on_container_move_assignment::value;
+        if constexpr (propagate) {
+            unordered_map temp(std::move(other));
+            swapAll(temp);
+        } else {
+            unordered_map temp(std::move(other), get_allocator());
+            swapAll(temp);
+        }
+        return *this;
+    }
+
+    allocator_type get_allocator() const noexcept { return allocator_type(_node_alloc); }
+
+    /*** Iterators ***/
+    // begin() is the head of the node list so it's O(1) and iterating never
+    // touches empty buckets
+    iterator       begin() noexcept { return iterator(_before_begin.next); }
+    const_iterator begin() const noexcept { return const_iterator(_before_begin.next); }
+    const_iterator cbegin() const noexcept { return begin(); }
+
+    iterator       end() noexcept { return iterator(); }
+    const_iterator end() const noexcept { return const_iterator(); }
+    const_iterator cend() const noexcept { return end(); }
 
     /*** Lookup ***/
+    // Every lookup also has a template overload for heterogeneous keys
+    // (e.g. std::string_view into a map of std::string), only enabled when
+    // both Hash and KeyEqual declare is_transparent like the STL does
     T& at(const Key& key) {
         return const_cast<T&>(std::as_const(*this).at(key));
     }
-    const T& at(const Key& key) const;
+    const T& at(const Key& key) const { return atHelper(key); }
+
+    template <class K> requires is_transparent<K>
+    T& at(const K& key) { return const_cast<T&>(atHelper(key)); }
+    template <class K> requires is_transparent<K>
+    const T& at(const K& key) const { return atHelper(key); }
+
+    T& operator[](const Key& key) { return try_emplace(key).first->second; }
+    T& operator[](Key&& key) { return try_emplace(std::move(key)).first->second; }
+
+    iterator find(const Key& key) { return iterator(findHelper(key)); }
+    const_iterator find(const Key& key) const { return const_iterator(findHelper(key)); }
+
+    template <class K> requires is_transparent<K>
+    iterator find(const K& key) { return iterator(findHelper(key)); }
+    template <class K> requires is_transparent<K>
+    const_iterator find(const K& key) const { return const_iterator(findHelper(key)); }
 
-    T& operator[](const Key& key) { return subscriptHelper(key); }
-    T& operator[](Key&& key) { return subscriptHelper(std::move(key)); }
+    bool contains(const Key& key) const { return findHelper(key) != nullptr; }
+    template <class K> requires is_transparent<K>
+    bool contains(const K& key) const { return findHelper(key) != nullptr; }
+
+    size_type count(const Key& key) const { return contains(key); }
+    template <class K> requires is_transparent<K>
+    size_type count(const K& key) const { return contains(key); }
 
     /*** Modifiers ***/
+    // Keeps the bucket array, just empties it
     void clear() noexcept {
-        _buckets = std::make_unique<std::list<value_type>[]>(default_resize);
-        _bucket_count = default_resize;
+        destroyNodes(_before_begin.next);
+        _before_begin.next = nullptr;
+        std::fill_n(_buckets, _bucket_count, nullptr);
         _size = 0;
     }
 
     std::pair<iterator, bool> insert(const value_type &x) {
-        return emplace_unique(std::forward<value_type>(x));
+        return try_emplace(x.first, x.second);
     }
 
+    // The key is const inside the pair so only the mapped value can be moved
     std::pair<iterator, bool> insert(value_type &&x) {
-        return emplace_unique(std::move(x));
+        return try_emplace(x.first, std::move(x.second));
     }
 
     template <class P, std::__enable_if_t<std::is_constructible<value_type, P>::value, int> = 0>
     std::pair<iterator, bool> insert(P &&x) {
-        return emplace_unique(std::forward<P>(x));
+        return emplace(std::forward<P>(x));
     }
 
-    // I ignore the const_iterator portion due to the non homogeneous linked list backing array
+    // Hints are ignored, the bucket is always found from the hash
     iterator insert(const_iterator, const value_type &x) { return insert(x).first; }
-    iterator insert(const_iterator, value_type &&x) { return emplace_unique(std::move(x)).first; }
+    iterator insert(const_iterator, value_type &&x) { return insert(std::move(x)).first; }
 
     template <class P, std::__enable_if_t<std::is_constructible<value_type, P>::value, int> = 0>
     iterator insert(const_iterator, P &&x) {
         return insert(std::forward<P>(x)).first;
     }
 
+    // Forward ranges are sized up front: reserve once, hash every key in a
+    // first pass, then scatter into the buckets in a second pass.
+    // Plain input iterators can only be walked once so they insert one by one
     template<class InputIt>
     void insert(InputIt first, InputIt last) {
-        for (; first != last; ++first)
-            emplace_unique(*first);
+        using category = typename std::iterator_traits<InputIt>::iterator_category;
+
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+            const auto n = static_cast<size_type>(std::distance(first, last));
+            if (!n) return;
+
+            reserve(size() + n);
+
+            std::vector<std::size_t> hashes;
+            hashes.reserve(n);
+            for (auto it = first; it != last; ++it)
+                hashes.push_back(_hash_function(it->first));
+
+            auto h = hashes.begin();
+            for (; first != last; ++first, ++h)
+                emplaceHashed(*h, first->first, first->second);
+        } else {
+            for (; first != last; ++first)
+                emplace(*first);
+        }
     }
 
     void insert(std::initializer_list<value_type> ilist) {
         insert(ilist.begin(), ilist.end());
     }
 
-    template <class... _Args>
-    std::pair<iterator, bool> emplace(_Args&&... __args) {
-        return emplace_unique(std::forward<_Args>(__args)...);
+    // Only constructs the value if the key is missing, args are left untouched otherwise
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+        return tryEmplaceHelper(key, std::forward<Args>(args)...);
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args) {
+        return tryEmplaceHelper(std::move(key), std::forward<Args>(args)...);
+    }
+
+    // Heterogeneous version, Key is only built from K on a miss
+    template <class K, class... Args>
+    requires (is_transparent<K> && std::is_constructible_v<Key, K&&>
+              && !std::is_convertible_v<K&&, const Key&>)
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+        return tryEmplaceHelper(std::forward<K>(key), std::forward<Args>(args)...);
+    }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& obj) {
+        return insertOrAssignHelper(key, std::forward<M>(obj));
     }
 
-    iterator erase(const_iterator pos) {
-        auto index = _hash_function(pos) % bucket_count();
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(Key&& key, M&& obj) {
+        return insertOrAssignHelper(std::move(key), std::forward<M>(obj));
     }
 
+    // When the key can be pulled out of the arguments this is just try_emplace,
+    // otherwise the node has to be built before the duplicate check
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        if constexpr (sizeof...(Args) == 2) {
+            return emplaceKeyValue(std::forward<Args>(args)...);
+        } else if constexpr (sizeof...(Args) == 1
+                             && (is_pair_like<std::remove_cvref_t<Args>> && ...)) {
+            return emplacePair(std::forward<Args>(args)...);
+        } else {
+            return emplaceNode(std::forward<Args>(args)...);
+        }
+    }
+
+    iterator erase(const_iterator pos);
     iterator erase(const_iterator first, const_iterator last);
-    size_type erase(const key_type& key);
+    size_type erase(const key_type& key) { return eraseHelper(key); }
+
+    template <class K>
+    requires (is_transparent<K> && !std::is_convertible_v<K&&, const_iterator>)
+    size_type erase(K&& key) { return eraseHelper(key); }
+
+    void swap(unordered_map &other) noexcept;
 
 
     /*** Capacity ***/
@@ -224,7 +468,7 @@ public:
     size_type size()     const noexcept { return _size; }
     size_type max_size() const noexcept { 
         return std::min<size_type>(
-            _buckets.get().max_size(),
+            node_traits::max_size(_node_alloc),
             std::numeric_limits<difference_type >::max()
         );
     }
@@ -232,10 +476,20 @@ public:
     /*** Bucket interface ***/
     size_type bucket_count() const { return _bucket_count; }
 
+    /*** Observers ***/
+    hasher hash_function() const { return _hash_function; }
+    key_equal key_eq() const { return _key_eq; }
+
     /*** Hash policy ***/
+    float load_factor() const { return _bucket_count ? float(_size) / _bucket_count : 0.f; }
     float max_load_factor() const { return _max_load_factor; }
-    void max_load_factor(float ml) { _max_load_factor = max_load_factor(); } ;
+    void max_load_factor(float ml) { _max_load_factor = ml; }
     void rehash(size_type count);
+
+    // Sets the bucket count so that count elements fit without exceeding max_load_factor()
+    void reserve(size_type count) {
+        rehash(static_cast<size_type>(std::ceil(count / max_load_factor())));
+    }
     
     // not defined in STL
     std::string toString() {
@@ -244,11 +498,14 @@ public:
 
         for (; idx < _bucket_count; ++idx) {
             out += std::to_string(idx) + " : ";
-            for (const auto &kv : _buckets[idx])
+
+            for (auto n = firstInBucket(idx); n; n = nextInBucket(n, idx)) {
+                const auto &kv = n->value();
                 out += std::to_string(kv.first) 
                     + "-" 
                     + std::to_string(kv.second) 
-                    + (&kv != &_buckets[idx].back() ? ", " : " ");
+                    + (nextInBucket(n, idx) ? ", " : " ");
+            }
 
             out.back() = '\n';
         }
@@ -256,6 +513,9 @@ public:
         return out;
     }
 
+    // not defined in STL, walks every bucket once so it's O(bucket_count + size)
+    hash_table_stats stats() const;
+
 private:
 /* If you examine the LLVM Clang++ 21 unordered_map implementation you find
  * 4 member variables:
@@ -272,58 +532,299 @@ private:
  *  __p2_ is a compressed pair of the number of elments and the hasher, if provided
  *  __p3_ is the max loadfactor (default 1.0) which is the number of entries / number of buckets
  *
- *  This is obviously too complex to implement so I will be sticking with 
- *  the STL's linked-list implementation
+ *  This is the layout used here (minus the compressed pairs):
+ *  - every node is in one singly linked list starting at _before_begin.next
+ *  - nodes of the same bucket are always next to each other in that list
+ *  - _buckets[i] points at the node *before* the first node of bucket i
+ *    (that's _before_begin for whichever bucket is first), or is nullptr
+ *  Pointing at the predecessor is what lets insert/erase relink in O(1)
+ *  with only one link per node.
  */
-    std::unique_ptr<std::list<value_type, allocator_type>[]> _buckets;
+    hash_node_base                         **_buckets;
     size_type                                _bucket_count;
     size_type                                _size;
     float                                    _max_load_factor;
     hasher                                   _hash_function;
     key_equal                                _key_eq;
-    allocator_type                           _allocator;
+    node_allocator                           _node_alloc;
+    hash_node_base                           _before_begin;
+
+    // Stats counters, the lookup ones are atomic since find() is const and may
+    // be called from several threads, but are only touched on sampled lookups
+    size_type                                _rehash_count = 0;
+    mutable std::atomic<size_type>           _sampled_lookups{0};
+    mutable std::atomic<size_type>           _sampled_probes{0};
 
     /*** Private helpers ***/
-    T& subscriptHelper(key_type &&key) {
-        if (!_bucket_count) {
-            int newBucketCount = nextPrime(bucket_count());
-            rehash(newBucketCount);
+    static node_type* asNode(hash_node_base *n) noexcept { return static_cast<node_type*>(n); }
+
+    size_type bucketOf(std::size_t hash) const noexcept { return hash % _bucket_count; }
+
+    node_type* firstInBucket(size_type idx) const noexcept {
+        return _buckets[idx] ? asNode(_buckets[idx]->next) : nullptr;
+    }
+
+    // nullptr once the chain runs into the next bucket
+    node_type* nextInBucket(node_type *n, size_type idx) const noexcept {
+        auto next = asNode(n->next);
+        return next && bucketOf(next->hash) == idx ? next : nullptr;
+    }
+
+    // Grows geometrically so n inserts cost O(log n) rehashes instead of O(n)
+    void growIfNeeded(size_type newSize) {
+        if (newSize <= bucket_count()*max_load_factor())
+            return;
+
+        const size_type needed = static_cast<size_type>(std::ceil(newSize / max_load_factor()));
+        rehash(std::max(bucket_count() * growth_factor, needed));
+    }
+
+    static hash_node_base** allocateBuckets(node_allocator alloc, size_type n) {
+        bucket_allocator bucketAlloc(alloc);
+        hash_node_base **out = bucket_traits::allocate(bucketAlloc, n);
+        std::fill_n(out, n, nullptr);
+        return out;
+    }
+
+    void deallocateBuckets() noexcept {
+        if (!_buckets)
+            return;
+
+        bucket_allocator bucketAlloc(_node_alloc);
+        bucket_traits::deallocate(bucketAlloc, _buckets, _bucket_count);
+        _buckets = nullptr;
+    }
+
+    // Everything but the allocators, see swap()
+    void swapContents(unordered_map &other) noexcept;
+
+    // For the assignment operators, the temporary always takes the allocator
+    void swapAll(unordered_map &other) noexcept {
+        swapContents(other);
+        std::swap(_node_alloc, other._node_alloc);
+    }
+
+    template <class... Args>
+    node_type* makeNode(Args&&... args) {
+        node_type *n = node_traits::allocate(_node_alloc, 1);
+        ::new (static_cast<void*>(n)) node_type;
+
+        try {
+            node_traits::construct(_node_alloc,
+                                   static_cast<value_type*>(n->raw()),
+                                   std::forward<Args>(args)...);
+        } catch (...) {
+            node_traits::deallocate(_node_alloc, n, 1);
+            throw;
         }
 
-        auto index = _hash_function(key) % bucket_count();
+        return n;
+    }
 
-        for (auto &node : _buckets[index])
-            if (_key_eq(node.first, key))
-                return node.second;
+    void destroyNode(node_type *n) noexcept {
+        node_traits::destroy(_node_alloc, std::addressof(n->value()));
+        node_traits::deallocate(_node_alloc, n, 1);
+    }
 
-        if (size()+1 > bucket_count()*max_load_factor()) {
-            int newBucketCount = nextPrime(bucket_count());
-            rehash(newBucketCount);
+    void destroyNodes(hash_node_base *n) noexcept {
+        while (n) {
+            auto next = n->next;
+            destroyNode(asNode(n));
+            n = next;
         }
+    }
 
-        index = _hash_function(key) % bucket_count();
+    // Links a node into its bucket, assumes the key is absent and the table has room
+    node_type* linkNode(node_type *n) noexcept {
+        const size_type idx = bucketOf(n->hash);
+        hash_node_base *prev = _buckets[idx];
+
+        if (prev) {
+            n->next = prev->next;
+            prev->next = n;
+        } else {
+            // Empty bucket, the node goes to the very front of the list and
+            // the bucket that used to be first now comes after it
+            n->next = _before_begin.next;
+            _before_begin.next = n;
+            _buckets[idx] = &_before_begin;
+
+            if (n->next)
+                _buckets[bucketOf(asNode(n->next)->hash)] = n;
+        }
 
-        _buckets[index].push_front(value_type{key, T{}});
         ++_size;
-        return _buckets[index].front().second;
+        return n;
+    }
+
+    // Unlinks n given the node right before it, returns the node after it
+    hash_node_base* unlinkNode(hash_node_base *prev, node_type *n) noexcept {
+        const size_type idx = bucketOf(n->hash);
+        hash_node_base *next = n->next;
+
+        if (prev == _buckets[idx] && (!next || bucketOf(asNode(next)->hash) != idx))
+            _buckets[idx] = nullptr;
+
+        if (next) {
+            const size_type nextIdx = bucketOf(asNode(next)->hash);
+            if (nextIdx != idx)
+                _buckets[nextIdx] = prev;
+        }
+
+        prev->next = next;
+        --_size;
+        return next;
+    }
+
+    template <class K>
+    node_type* findHashed(std::size_t hash, const K &key) const {
+        if (!_bucket_count)
+            return nullptr;
+
+        const size_type idx = bucketOf(hash);
+        for (auto n = firstInBucket(idx); n; n = nextInBucket(n, idx))
+            if (n->hash == hash && _key_eq(n->value().first, key))
+                return n;
+
+        return nullptr;
     }
 
-    std::pair<iterator, bool> emplace_unique(value_type &&x) {
-        if (size()+1 > bucket_count()*max_load_factor()) {
-            int newBucketCount = nextPrime(bucket_count());
-            rehash(newBucketCount);
+    template <class K>
+    node_type* findHelper(const K &key) const {
+        if (empty())
+            return nullptr;
+
+        // Per thread countdown so unsampled lookups never write shared memory
+        static thread_local std::size_t untilSample = lookup_sample_rate;
+
+        const std::size_t hash = _hash_function(key);
+        if (--untilSample) [[likely]]
+            return findHashed(hash, key);
+
+        untilSample = lookup_sample_rate;
+        return sampledFind(hash, key);
+    }
+
+    template <class K>
+    node_type* sampledFind(std::size_t hash, const K &key) const {
+        const size_type idx = bucketOf(hash);
+        size_type probes = 0;
+        node_type *found = nullptr;
+
+        for (auto n = firstInBucket(idx); n; n = nextInBucket(n, idx)) {
+            ++probes;
+            if (n->hash == hash && _key_eq(n->value().first, key)) {
+                found = n;
+                break;
+            }
         }
 
-        auto key = _hash_function(x.first);
-        auto index = key % bucket_count();
-        
-        for (auto &node : _buckets[index])
-            if (_key_eq(node.first, key)) 
-                return std::pair{&node, false};
+        _sampled_lookups.fetch_add(1, std::memory_order_relaxed);
+        _sampled_probes.fetch_add(probes, std::memory_order_relaxed);
+        return found;
+    }
+
+    template <class K>
+    const T& atHelper(const K &key) const {
+        if (empty())
+            throw(std::out_of_range("Empty map"));
 
-        _buckets[index].push_front(x);
-        ++_size;
-        return {&_buckets[index].front(), true};
+        if (auto node = findHelper(key))
+            return node->value().second;
+
+        throw(std::out_of_range("No key found"));
+    }
+
+    // Assumes the key is absent and the table already has room for it
+    template <class... Args>
+    iterator emplaceNew(std::size_t hash, Args&&... args) {
+        node_type *n = makeNode(std::forward<Args>(args)...);
+        n->hash = hash;
+        return iterator(linkNode(n));
+    }
+
+    template <class K, class... Args>
+    std::pair<iterator, bool> tryEmplaceHelper(K &&key, Args&&... args) {
+        const std::size_t hash = _hash_function(key);
+        if (auto node = findHashed(hash, key))
+            return {iterator(node), false};
+
+        growIfNeeded(size() + 1);
+        return {emplaceNew(hash,
+                           std::piecewise_construct,
+                           std::forward_as_tuple(std::forward<K>(key)),
+                           std::forward_as_tuple(std::forward<Args>(args)...)),
+                true};
+    }
+
+    template <class K, class M>
+    std::pair<iterator, bool> insertOrAssignHelper(K &&key, M &&obj) {
+        auto res = tryEmplaceHelper(std::forward<K>(key), std::forward<M>(obj));
+        if (!res.second)
+            res.first->second = std::forward<M>(obj);
+        return res;
+    }
+
+    // Used by the bulk insert, the hash is precomputed and the table reserved
+    template <class K, class V>
+    std::pair<iterator, bool> emplaceHashed(std::size_t hash, K &&key, V &&value) {
+        if (auto node = findHashed(hash, key))
+            return {iterator(node), false};
+
+        return {emplaceNew(hash, std::forward<K>(key), std::forward<V>(value)), true};
+    }
+
+    template <class A, class B>
+    std::pair<iterator, bool> emplaceKeyValue(A &&a, B &&b) {
+        if constexpr (std::is_same_v<std::remove_cvref_t<A>, Key>)
+            return tryEmplaceHelper(std::forward<A>(a), std::forward<B>(b));
+        else
+            return emplaceNode(std::forward<A>(a), std::forward<B>(b));
+    }
+
+    template <class P>
+    std::pair<iterator, bool> emplacePair(P &&p) {
+        if constexpr (std::is_same_v<std::remove_cvref_t<decltype(p.first)>, Key>)
+            return tryEmplaceHelper(std::forward<P>(p).first, std::forward<P>(p).second);
+        else
+            return emplaceNode(std::forward<P>(p));
+    }
+
+    // The node has to exist before its key can be hashed, on a hit it's thrown away
+    template <class... Args>
+    std::pair<iterator, bool> emplaceNode(Args&&... args) {
+        node_type *n = makeNode(std::forward<Args>(args)...);
+        n->hash = _hash_function(n->value().first);
+
+        if (auto existing = findHashed(n->hash, n->value().first)) {
+            destroyNode(n);
+            return {iterator(existing), false};
+        }
+
+        growIfNeeded(size() + 1);
+        return {iterator(linkNode(n)), true};
+    }
+
+    template <class K>
+    size_type eraseHelper(const K &key) {
+        if (empty())
+            return 0;
+
+        const std::size_t hash = _hash_function(key);
+        const size_type idx = bucketOf(hash);
+        hash_node_base *prev = _buckets[idx];
+        if (!prev)
+            return 0;
+
+        for (auto n = asNode(prev->next); n && bucketOf(n->hash) == idx; prev = n, n = asNode(n->next)) {
+            if (n->hash == hash && _key_eq(n->value().first, key)) {
+                unlinkNode(prev, n);
+                destroyNode(n);
+                return 1;
+            }
+        }
+
+        return 0;
     }
 };
 
@@ -342,15 +843,18 @@ unordered_map<Key, T, Hash, KeyEqual, Allocator>
                 const key_equal &equal, 
                 const Allocator &alloc)
 : _buckets(nullptr), _bucket_count(0), _size(0), _max_load_factor(1.f),
-    _hash_function(hash), _key_eq(equal), _allocator(alloc)
-{/* Empty ctor */}
+    _hash_function(hash), _key_eq(equal), _node_alloc(alloc)
+{
+    if (bucket_count)
+        rehash(bucket_count);
+}
 
 
 template <typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
 unordered_map<Key, T, Hash, KeyEqual, Allocator>
 ::unordered_map(const Allocator& alloc)
 : _buckets(nullptr), _bucket_count(0), _size(0), _max_load_factor(1.f),
-    _hash_function(hasher{}), _key_eq(key_equal{}), _allocator(alloc)
+    _hash_function(hasher{}), _key_eq(key_equal{}), _node_alloc(alloc)
 {/* Empty ctor */}
 
 template <typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
@@ -362,35 +866,129 @@ unordered_map<Key, T, Hash, KeyEqual, Allocator>
                 const key_equal& equal,
                 const Allocator& alloc)
 : _buckets(nullptr), _bucket_count(0), _size(0), _max_load_factor(1.f),
-    _hash_function(hash), _key_eq(equal), _allocator(alloc)
-{ insert(first, last); }
+    _hash_function(hash), _key_eq(equal), _node_alloc(alloc)
+{
+    if (bucket_count)
+        rehash(bucket_count);
+    insert(first, last);
+}
 
+// Same bucket count as other and the cached hashes are reused, so the hasher
+// is never called while copying
 template <typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
 unordered_map<Key, T, Hash, KeyEqual, Allocator>
 ::unordered_map(const unordered_map &other, const Allocator &alloc)
-: _allocator(alloc)
+: _buckets(nullptr), _bucket_count(0), _size(0), _max_load_factor(other._max_load_factor),
+    _hash_function(other._hash_function), _key_eq(other._key_eq), _node_alloc(alloc)
+{
+    if (!other._bucket_count)
+        return;
+
+    _buckets = allocateBuckets(_node_alloc, other._bucket_count);
+    _bucket_count = other._bucket_count;
+
+    for (auto n = other._before_begin.next; n; n = n->next) {
+        node_type *copy = makeNode(asNode(n)->value());
+        copy->hash = asNode(n)->hash;
+        linkNode(copy);
+    }
+}
+
+template <typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+unordered_map<Key, T, Hash, KeyEqual, Allocator>
+::unordered_map(unordered_map &&other) noexcept
+: _buckets(other._buckets), _bucket_count(other._bucket_count), _size(other._size),
+    _max_load_factor(other._max_load_factor), _hash_function(std::move(other._hash_function)),
+    _key_eq(std::move(other._key_eq)), _node_alloc(std::move(other._node_alloc)),
+    _rehash_count(other._rehash_count)
 {
-    _buckets = std::make_unique<std::list<value_type>[]>(other._bucket_count);
+    _before_begin.next = other._before_begin.next;
+
+    // The first bucket pointed at other's sentinel
+    if (_before_begin.next)
+        _buckets[bucketOf(asNode(_before_begin.next)->hash)] = &_before_begin;
+
+    other._before_begin.next = nullptr;
+    other._buckets = nullptr;
+    other._bucket_count = other._size = 0;
+}
+
+template <typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+unordered_map<Key, T, Hash, KeyEqual, Allocator>
+::unordered_map(unordered_map &&other, const Allocator &alloc)
+: _buckets(nullptr), _bucket_count(0), _size(0), _max_load_factor(other._max_load_factor),
+    _hash_function(other._hash_function), _key_eq(other._key_eq), _node_alloc(alloc)
+{
+    if (_node_alloc == other._node_alloc) {
+        swapContents(other);
+        return;
+    }
+
+    if (!other._bucket_count)
+        return;
+
+    _buckets = allocateBuckets(_node_alloc, other._bucket_count);
     _bucket_count = other._bucket_count;
-    _size = other.size();
-    _max_load_factor = other.max_load_factor();
-    _key_eq = other._key_eq;
 
-    for (int i = 0; i < _bucket_count; ++i)
-        _buckets[i] = other._buckets[i];
+    for (auto n = other._before_begin.next; n; n = n->next) {
+        node_type *moved = makeNode(std::move(asNode(n)->value()));
+        moved->hash = asNode(n)->hash;
+        linkNode(moved);
+    }
+
+    other.clear();
 }
 
-/*** Lookup ***/
+/*** Modifiers ***/
 template <typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
-const T& unordered_map<Key, T, Hash, KeyEqual, Allocator>::at(const Key &key) const {
-    if (empty())
-        throw(std::out_of_range("Empty map"));
+typename unordered_map<Key, T, Hash, KeyEqual, Allocator>::iterator
+unordered_map<Key, T, Hash, KeyEqual, Allocator>::erase(const_iterator pos) {
+    node_type *n = asNode(pos._node);
+    hash_node_base *prev = _buckets[bucketOf(n->hash)];
 
-    for (auto &node : _buckets[_hash_function(key) % _bucket_count])
-        if (node.first == key) 
-            return node.second;
+    while (prev->next != n)
+        prev = prev->next;
 
-    throw(std::out_of_range("No key found"));
+    iterator next(unlinkNode(prev, n));
+    destroyNode(n);
+    return next;
+}
+
+template <typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename unordered_map<Key, T, Hash, KeyEqual, Allocator>::iterator
+unordered_map<Key, T, Hash, KeyEqual, Allocator>::erase(const_iterator first, const_iterator last) {
+    while (first != last)
+        first = erase(first);
+
+    return iterator(last._node);
+}
+
+template <typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void unordered_map<Key, T, Hash, KeyEqual, Allocator>::swap(unordered_map &other) noexcept {
+    // Like std::, swapping maps with unequal non propagating allocators is UB
+    swapContents(other);
+
+    if constexpr (node_traits::propagate_on_container_swap::value)
+        std::swap(_node_alloc, other._node_alloc);
+}
+
+template <typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void unordered_map<Key, T, Hash, KeyEqual, Allocator>::swapContents(unordered_map &other) noexcept {
+    using std::swap;
+    swap(_buckets, other._buckets);
+    swap(_bucket_count, other._bucket_count);
+    swap(_size, other._size);
+    swap(_max_load_factor, other._max_load_factor);
+    swap(_hash_function, other._hash_function);
+    swap(_key_eq, other._key_eq);
+    swap(_before_begin.next, other._before_begin.next);
+    swap(_rehash_count, other._rehash_count);
+
+    // Each first bucket still points at the other map's sentinel
+    if (_before_begin.next)
+        _buckets[bucketOf(asNode(_before_begin.next)->hash)] = &_before_begin;
+    if (other._before_begin.next)
+        other._buckets[other.bucketOf(asNode(other._before_begin.next)->hash)] = &other._before_begin;
 }
 
 /*** Hash policy ***/
@@ -405,22 +1003,78 @@ void unordered_map<Key, T, Hash, KeyEqual, Allocator>::rehash(size_type n) {
     if (n < min_buckets)
         n = min_buckets;
 
+    if (!isPrime(n))
+        n = nextPrime(n);
+
     if (n == _bucket_count)
         return;
 
-    auto newBuckets = std::make_unique<std::list<value_type>[]>(n);
+    hash_node_base **fresh = allocateBuckets(_node_alloc, n);
+    deallocateBuckets();
+    _buckets = fresh;
+    _bucket_count = n;
+    ++_rehash_count;
+    MY_INSTRUMENT_ADD(value_type, reallocations, 1);
+
+    // One pass over the list with the cached hashes: a node whose bucket was
+    // already started further back gets moved right after that bucket's head
+    hash_node_base *prev = &_before_begin;
+    hash_node_base *curr = prev->next;
+    if (!curr)
+        return;
 
-    for (int i = 0; i < bucket_count(); ++i) {
-        auto it = _buckets[i].begin();
-        while (it != _buckets[i].end()) {
-            auto curr = it++;
-            auto newIndex = _hash_function(curr->first) % n;
-            newBuckets[newIndex].splice(newBuckets[newIndex].begin(), _buckets[i], curr);
+    size_type prevIdx = bucketOf(asNode(curr)->hash);
+    _buckets[prevIdx] = prev;
+
+    for (prev = curr, curr = curr->next; curr; curr = prev->next) {
+        const size_type idx = bucketOf(asNode(curr)->hash);
+
+        if (idx == prevIdx) {
+            prev = curr;
+        } else if (!_buckets[idx]) {
+            _buckets[idx] = prev;
+            prev = curr;
+            prevIdx = idx;
+        } else {
+            prev->next = curr->next;
+            curr->next = _buckets[idx]->next;
+            _buckets[idx]->next = curr;
         }
     }
+}
 
-    std::swap(_buckets, newBuckets);
-    _bucket_count = n;
+/*** Stats ***/
+template <typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+hash_table_stats unordered_map<Key, T, Hash, KeyEqual, Allocator>::stats() const {
+    hash_table_stats out;
+    out.size            = size();
+    out.bucket_count    = bucket_count();
+    out.load_factor     = load_factor();
+    out.rehash_count    = _rehash_count;
+    out.bytes_allocated = bucket_count() * sizeof(hash_node_base*) + size() * sizeof(node_type);
+    out.sampled_lookups = _sampled_lookups.load(std::memory_order_relaxed);
+    out.sampled_probes  = _sampled_probes.load(std::memory_order_relaxed);
+
+    for (size_type i = 0; i < bucket_count(); ++i) {
+        std::size_t chain = 0;
+        for (auto n = firstInBucket(i); n; n = nextInBucket(n, i))
+            ++chain;
+
+        out.empty_buckets += !chain;
+        out.max_chain = std::max(out.max_chain, chain);
+        ++out.chain_histogram[std::min(chain, stats_histogram_size - 1)];
+    }
+
+    const std::size_t used = out.bucket_count - out.empty_buckets;
+    out.mean_chain = used ? double(out.size) / used : 0;
+
+    return out;
+}
+
+template <typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void swap(unordered_map<Key, T, Hash, KeyEqual, Allocator> &lhs,
+          unordered_map<Key, T, Hash, KeyEqual, Allocator> &rhs) noexcept {
+    lhs.swap(rhs);
 }
 
 } // namespace My
@@ -2,6 +2,10 @@
 
 #include <bits/stdc++.h>
 #include <memory>
+#include <unistd.h>
+
+#include "my_instrument.hpp"
+#include "my_simd.hpp"
 
 namespace My {
 
@@ -12,12 +16,60 @@ namespace My {
  *       want this to be an extra 2000 lines
  */
 
+// Types whose objects can be moved to a new address by copying their bytes
+// and not running the destructor on the old ones. Trivially copyable types
+// always can, specialize it for your own types that also can (no pointers
+// into themselves, nothing registered by address)
+// NOTE: libstdc++'s std::string points into itself for SSO, so it can't
+template <class T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template <class T>
+inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+// Moves n elements from first into the uninitialized dest and destroys the
+// originals. Relocatable types are one memcpy, otherwise elements are moved
+// if that can't throw and copied if it can, so on an exception the source
+// is left untouched
+template <class Alloc, class T>
+void uninitialized_relocate(Alloc &alloc, T *first, std::size_t n, T *dest) {
+    using traits = instrument::traits_for<Alloc>;
+
+    if constexpr (is_trivially_relocatable_v<T>) {
+        if (n)
+            std::memcpy(static_cast<void*>(dest), static_cast<const void*>(first), n * sizeof(T));
+        MY_INSTRUMENT_ADD(T, relocations, n);
+    } else {
+        std::size_t i = 0;
+        try {
+            for (; i < n; ++i)
+                traits::construct(alloc, dest + i, std::move_if_noexcept(first[i]));
+        } catch (...) {
+            for (std::size_t j = 0; j < i; ++j)
+                traits::destroy(alloc, dest + j);
+            throw;
+        }
+
+        for (i = 0; i < n; ++i)
+            traits::destroy(alloc, first + i);
+    }
+}
+
+// Allocators with a reallocate(p, oldN, newN) that resizes a block keeping
+// its bytes (e.g. mremap, see my_mmap_allocator.hpp) and returns nullptr when
+// it can't. vector only uses it for relocatable types since nothing runs on
+// the elements if the block moves
+template <class Alloc, class T>
+concept reallocating_allocator = requires(Alloc &alloc, T *p, std::size_t n) {
+    { alloc.reallocate(p, n, n) } -> std::same_as<T*>;
+};
+
 template <typename T, typename Allocator = std::allocator<T>>
 class vector {
 public:
     /*** C++ Standard Named Requirements for Containers***/
     using allocator_type  = Allocator;
-    using __alloc_traits  = std::allocator_traits<Allocator>;
+    using __alloc_traits  = instrument::traits_for<Allocator>;
     using size_type       = typename __alloc_traits::size_type;
 
     using value_type      = T;
@@ -106,19 +158,42 @@ public:
     size_type max_size() const noexcept { 
         return __alloc_traits::max_size(allocator_); 
     }
+    void reserve(size_type newCap);
+    void shrink_to_fit();
 
     /*** Modifiers ***/
     void clear();
     iterator insert(const_iterator pos, const_reference value);
+    iterator insert(const_iterator pos, size_type count, const_reference value);
+    template <class InputIt,
+              class Enable = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+    iterator insert(const_iterator pos, InputIt first, InputIt last);
+    iterator insert(const_iterator pos, std::initializer_list<value_type> ilist) {
+        return insert(pos, ilist.begin(), ilist.end());
+    }
+    template <class R>
+    void append_range(R &&rg);
     iterator erase(iterator pos);
-    void push_back(const_reference value);
+    iterator erase(const_iterator first, const_iterator last);
+    void push_back(const_reference value) { emplace_back(value); }
+    void push_back(value_type &&value) { emplace_back(std::move(value)); }
+    template <class... Args>
+    reference emplace_back(Args&&... args);
     void pop_back();
-    void resize(size_type count, const_reference value = size_type());
+    void resize(size_type count);
+    void resize(size_type count, const_reference value);
+
+    // not defined in STL
+    // Like resize() but new elements are left uninitialized, for buffers that
+    // are about to be overwritten anyway (read(), recv(), memcpy). Returns the
+    // new elements, empty when shrinking
+    std::span<value_type> resize_for_overwrite(size_type count);
+    std::span<value_type> append_uninitialized(size_type n) { return resize_for_overwrite(size_ + n); }
+    // Like std::, swapping vectors with unequal non propagating allocators is UB
     void swap(vector &other) {
-        std::swap(size_, other.size_);
-        std::swap(data_, other.data_);
-        std::swap(capacity_, other.capacity_);
-        std::swap(allocator_, other.allocator_);
+        swapContents(other);
+        if constexpr (__alloc_traits::propagate_on_container_swap::value)
+            std::swap(allocator_, other.allocator_);
     }
 
 
@@ -126,22 +201,46 @@ public:
     allocator_type get_allocator() const { return allocator_; }
 
 
-private:
+// small_vector reuses the storage directly
+protected:
     pointer        data_;
     size_type      capacity_;
     size_type      size_;
     allocator_type allocator_;
 
 
+    void swapContents(vector &other) noexcept {
+        std::swap(size_, other.size_);
+        std::swap(data_, other.data_);
+        std::swap(capacity_, other.capacity_);
+    }
+
+    // For the assignment operators, the temporary always takes the allocator
+    void swapAll(vector &other) noexcept {
+        swapContents(other);
+        std::swap(allocator_, other.allocator_);
+    }
+
+    // Arithmetic T with an allocator that doesn't customize construct() can
+    // skip allocator_traits and go through the My::simd kernels
+    static constexpr bool use_simd = simd::vectorizable<T>
+        && !requires(Allocator &alloc, T *p, const T &v) { alloc.construct(p, v); };
+
+    size_type nextCapacity() const { return capacity_ ? capacity_ << 1 : 1; }
+
+    // Moves the elements into a buffer of newCap >= size_, see uninitialized_relocate
     void grow(size_type newCap) {
-        auto temp = __alloc_traits::allocate(allocator_, newCap);
+        MY_INSTRUMENT_ADD(T, reallocations, 1);
+        if (reallocateInPlace(newCap))
+            return;
 
-        int i = 0;
-        auto from = begin(), to = end();
+        pointer temp = newCap ? __alloc_traits::allocate(allocator_, newCap) : nullptr;
 
-        for (; from != to && i < newCap; ++from, ++i) {
-            __alloc_traits::construct(allocator_, temp + i, *from);
-            __alloc_traits::destroy(allocator_, from);
+        try {
+            uninitialized_relocate(allocator_, data_, size_, temp);
+        } catch (...) {
+            __alloc_traits::deallocate(allocator_, temp, newCap);
+            throw;
         }
 
         __alloc_traits::deallocate(allocator_, data_, capacity_);
@@ -149,6 +248,35 @@ private:
         data_ = temp;
         capacity_ = newCap;
     }
+
+    template <class... Args>
+    void growAndEmplaceBack(Args&&... args);
+
+    // Lets the allocator resize the block itself, false if it can't
+    bool reallocateInPlace(size_type newCap) {
+        if constexpr (is_trivially_relocatable_v<T> && reallocating_allocator<Allocator, T>) {
+            if (data_ && newCap) {
+                if (pointer temp = allocator_.reallocate(data_, capacity_, newCap)) {
+                    data_ = temp;
+                    capacity_ = newCap;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // The bulk insert/erase helpers shift the tail by relocating it (move
+    // construct + destroy, or one memmove for relocatable types) so it only
+    // ever moves once, however many elements go in or out
+    void relocateRight(pointer first, size_type n, pointer dest);
+    void relocateLeft(pointer first, size_type n, pointer dest);
+
+    // Leaves k uninitialized slots at idx, reallocating at most once
+    void openGap(size_type idx, size_type k);
+
+    template <class ForwardIt>
+    iterator insertN(size_type idx, ForwardIt first, size_type k);
 };
 
 // Default constructors
@@ -195,10 +323,17 @@ vector<T, Allocator>::vector(size_type count, const_reference v,
                              const allocator_type &alloc)
 : data_(nullptr), capacity_(count), size_(0), allocator_(alloc)
 {
-    data_ = std::allocator_traits<allocator_type>::allocate(allocator_, capacity_);
+    data_ = __alloc_traits::allocate(allocator_, capacity_);
+
+    if constexpr (use_simd) {
+        simd::fill(data_, count, v);
+        MY_INSTRUMENT_ADD(T, copies, count);
+        size_ = count;
+        return;
+    }
 
     for (; size_ < count; ++size_)
-        std::allocator_traits<Allocator>::construct(allocator_, data_ + size_, v);
+        __alloc_traits::construct(allocator_, data_ + size_, v);
 }
 
 
@@ -212,32 +347,47 @@ vector<T, Allocator>::vector(InputIt first, InputIt last,
     const difference_type numOfElems = std::distance(first, last);
 
     capacity_ = numOfElems;
-    data_ = std::allocator_traits<allocator_type>::allocate(allocator_, capacity_);
+    data_ = __alloc_traits::allocate(allocator_, capacity_);
 
     for (; first != last; ++first, ++size_)
-        std::allocator_traits<allocator_type>::construct(allocator_, data_ + size_, *first);
+        __alloc_traits::construct(allocator_, data_ + size_, *first);
 }
 
 
 // Copy constructors
 template <typename T, class Allocator>
 vector<T, Allocator>::vector(const vector &other)
-: data_(nullptr), capacity_(other.capacity_), size_(0), allocator_(other.allocator_)
+: data_(nullptr), capacity_(other.capacity_), size_(0),
+    allocator_(__alloc_traits::select_on_container_copy_construction(other.allocator_))
 {
-    data_ = std::allocator_traits<allocator_type>::allocate(allocator_, capacity_);
+    data_ = __alloc_traits::allocate(allocator_, capacity_);
+
+    if constexpr (use_simd) {
+        simd::copy(other.data_, other.size_, data_);
+        MY_INSTRUMENT_ADD(T, copies, other.size_);
+        size_ = other.size_;
+        return;
+    }
 
     for (; size_ < other.size_; ++size_)
-        std::allocator_traits<Allocator>::construct(allocator_, data_ + size_, *(other.data_ + size_));
+        __alloc_traits::construct(allocator_, data_ + size_, *(other.data_ + size_));
 }
 
 template <typename T, class Allocator>
 vector<T, Allocator>::vector(const vector &other, const allocator_type &alloc)
 : data_(nullptr), capacity_(other.capacity_), size_(0), allocator_(alloc)
 {
-    data_ = std::allocator_traits<allocator_type>::allocate(allocator_, capacity_);
+    data_ = __alloc_traits::allocate(allocator_, capacity_);
+
+    if constexpr (use_simd) {
+        simd::copy(other.data_, other.size_, data_);
+        MY_INSTRUMENT_ADD(T, copies, other.size_);
+        size_ = other.size_;
+        return;
+    }
 
     for (; size_ < other.size_; ++size_)
-        std::allocator_traits<Allocator>::construct(allocator_, data_ + size_, *(other.data_ + size_));
+        __alloc_traits::construct(allocator_, data_ + size_, *(other.data_ + size_));
 }
 
 
@@ -256,7 +406,7 @@ template <typename T, class Allocator>
 vector<T, Allocator>::vector(vector &&other, const allocator_type &alloc)
 : data_(nullptr), capacity_(0), size_(0), allocator_(alloc)
 {
-    using traits = std::allocator_traits<allocator_type>;
+    using traits = __alloc_traits;
     if (allocator_ == other.allocator_) {
         data_ = other.data_; size_ = other.size_; capacity_ = other.capacity_;
         other.data_ = nullptr; other.size_ = other.capacity_ = 0;
@@ -283,10 +433,10 @@ vector<T, Allocator>::vector(std::initializer_list<value_type> init,
                              const Allocator &alloc)
 : data_(nullptr), capacity_(init.size()), size_(0), allocator_(alloc)
 {
-    data_ = std::allocator_traits<Allocator>::allocate(allocator_, capacity_);
+    data_ = __alloc_traits::allocate(allocator_, capacity_);
 
     for(; size_ < init.size(); ++size_)
-        std::allocator_traits<Allocator>::construct(allocator_, data_ + size_, *(init.begin() + size_));
+        __alloc_traits::construct(allocator_, data_ + size_, *(init.begin() + size_));
 }
 
 
@@ -298,9 +448,9 @@ vector<T, Allocator>::~vector()
     auto to = end();
 
     for (; from != to; ++from)
-        std::allocator_traits<Allocator>::destroy(allocator_, from);
+        __alloc_traits::destroy(allocator_, from);
 
-    std::allocator_traits<allocator_type>::deallocate(allocator_, data_, capacity_);
+    __alloc_traits::deallocate(allocator_, data_, capacity_);
 
     size_ = 0; capacity_ = 0;
     data_ = nullptr;
@@ -308,11 +458,14 @@ vector<T, Allocator>::~vector()
 
 /*** Assignment operators ***/
 // Copy-on-swap https://stackoverflow.com/a/3279550/21144460
+// The allocator only follows the elements if it says it propagates (an arena
+// allocator doesn't), otherwise the copy is made with ours
 template <typename T, class Allocator>
 vector<T, Allocator>& vector<T, Allocator>::operator=(const vector &other)
 {
-    vector temp(other);
-    swap(temp);
+    constexpr bool propagate = __alloc_traits::propagate_on_container_copy_assignment::value;
+    vector temp(other, propagate ? other.allocator_ : allocator_);
+    swapAll(temp);
 
     return *this;
 }
@@ -321,8 +474,13 @@ vector<T, Allocator>& vector<T, Allocator>::operator=(const vector &other)
 template <typename T, class Allocator>
 vector<T, Allocator>& vector<T, Allocator>::operator=(vector &&other)
 {
-    vector temp(std::move(other));
-    swap(temp);
+    if constexpr (__alloc_traits::propagate_on_container_move_assignment::value) {
+        vector temp(std::move(other));
+        swapAll(temp);
+    } else {
+        vector temp(std::move(other), allocator_);
+        swapAll(temp);
+    }
 
     return *this;
 }
@@ -332,8 +490,8 @@ template <typename T, class Allocator>
 vector<T, Allocator>&
 vector<T, Allocator>::operator=(std::initializer_list<value_type> ilist)
 {
-    vector temp(ilist);
-    swap(temp);
+    vector temp(ilist, allocator_);
+    swapAll(temp);
 
     return *this;
 }
@@ -350,6 +508,13 @@ void vector<T, Allocator>::assign(size_type count, const_reference value)
         capacity_ = count;
     }
 
+    if constexpr (use_simd) {
+        simd::fill(data_, count, value);
+        MY_INSTRUMENT_ADD(T, copies, count);
+        size_ = count;
+        return;
+    }
+
     for (; size_ < count; ++size_)
         __alloc_traits::construct(allocator_, begin() + size_, value);
 
@@ -370,7 +535,7 @@ void vector<T, Allocator>::assign(InputIt first, InputIt last)
     }
 
     for (; first != last; ++first, ++size_)
-        std::allocator_traits<allocator_type>::construct(allocator_, data_ + size_, *first);
+        __alloc_traits::construct(allocator_, data_ + size_, *first);
 }
 
 template <typename T, class Allocator>
@@ -384,9 +549,8 @@ void vector<T, Allocator>::assign(std::initializer_list<value_type> ilist)
         capacity_ = ilist.size();
     }
 
-    size_ = ilist.size();
     for (const auto &i : ilist)
-        std::allocator_traits<allocator_type>::construct(allocator_, data_ + size_, i);
+        __alloc_traits::construct(allocator_, data_ + size_++, i);
 }
 
 /*** Element access ***/
@@ -413,7 +577,7 @@ template <typename T, class Allocator>
 void vector<T, Allocator>::clear()
 {
     for (auto from = begin(); from != end(); ++from)
-        std::allocator_traits<allocator_type>::destroy(allocator_, from);
+        __alloc_traits::destroy(allocator_, from);
     size_ = 0;
 }
 
@@ -421,11 +585,11 @@ template <typename T, class Allocator>
 typename vector<T, Allocator>::iterator 
 vector<T, Allocator>::insert(const_iterator pos, const_reference value)
 {
-    using traits = std::allocator_traits<allocator_type>;
+    using traits = __alloc_traits;
     size_type idx = pos - cbegin();
 
     if (size_ == capacity_)
-        grow(capacity_ ? capacity_ << 1 : 1);
+        grow(nextCapacity());
 
     T* const out = data_ + idx;
 
@@ -447,23 +611,240 @@ vector<T, Allocator>::insert(const_iterator pos, const_reference value)
 }
 
 template <typename T, class Allocator>
-void vector<T, Allocator>::push_back(const_reference value)
+typename vector<T, Allocator>::iterator
+vector<T, Allocator>::insert(const_iterator pos, size_type count, const_reference value)
 {
-    if (size_ == capacity_)
-        grow(!capacity_ ? 1 : capacity_ << 1);
+    // value may live in this vector, copy it before anything moves
+    const size_type idx = pos - cbegin();
+    if (!count)
+        return data_ + idx;
 
-    std::allocator_traits<allocator_type>::construct(allocator_, 
-                                                     data_ + size_,
-                                                     value);
+    const value_type copy(value);
+    openGap(idx, count);
+
+    size_type i = 0;
+    try {
+        for (; i < count; ++i)
+            __alloc_traits::construct(allocator_, data_ + idx + i, copy);
+    } catch (...) {
+        for (size_type j = 0; j < i; ++j)
+            __alloc_traits::destroy(allocator_, data_ + idx + j);
+        relocateLeft(data_ + idx + count, size_ - idx, data_ + idx);
+        throw;
+    }
+
+    size_ += count;
+    return data_ + idx;
+}
+
+// Single pass iterators can't be counted up front so they're buffered first
+template <typename T, class Allocator>
+template <class InputIt, class Enable>
+typename vector<T, Allocator>::iterator
+vector<T, Allocator>::insert(const_iterator pos, InputIt first, InputIt last)
+{
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    const size_type idx = pos - cbegin();
+
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+        return insertN(idx, first, static_cast<size_type>(std::distance(first, last)));
+    } else {
+        vector temp(allocator_);
+        for (; first != last; ++first)
+            temp.emplace_back(*first);
+
+        return insertN(idx, std::make_move_iterator(temp.begin()), temp.size());
+    }
+}
+
+template <typename T, class Allocator>
+template <class R>
+void vector<T, Allocator>::append_range(R &&rg)
+{
+    if constexpr (std::ranges::forward_range<R>) {
+        insertN(size_, std::ranges::begin(rg), static_cast<size_type>(std::ranges::distance(rg)));
+    } else {
+        for (auto &&x : rg)
+            emplace_back(std::forward<decltype(x)>(x));
+    }
+}
+
+template <typename T, class Allocator>
+template <class ForwardIt>
+typename vector<T, Allocator>::iterator
+vector<T, Allocator>::insertN(size_type idx, ForwardIt first, size_type k)
+{
+    if (!k)
+        return data_ + idx;
+
+    openGap(idx, k);
+
+    using source = std::remove_cvref_t<std::iter_reference_t<ForwardIt>>;
+    if constexpr (std::is_trivially_copyable_v<T> && std::contiguous_iterator<ForwardIt>
+                  && std::is_same_v<source, T>) {
+        std::memcpy(static_cast<void*>(data_ + idx), std::to_address(first), k * sizeof(T));
+        MY_INSTRUMENT_ADD(T, copies, k);
+    } else {
+        size_type i = 0;
+        try {
+            for (; i < k; ++i, ++first)
+                __alloc_traits::construct(allocator_, data_ + idx + i, *first);
+        } catch (...) {
+            for (size_type j = 0; j < i; ++j)
+                __alloc_traits::destroy(allocator_, data_ + idx + j);
+            relocateLeft(data_ + idx + k, size_ - idx, data_ + idx);
+            throw;
+        }
+    }
+
+    size_ += k;
+    return data_ + idx;
+}
+
+template <typename T, class Allocator>
+void vector<T, Allocator>::openGap(size_type idx, size_type k)
+{
+    if (size_ + k <= capacity_) {
+        relocateRight(data_ + idx, size_ - idx, data_ + idx + k);
+        return;
+    }
+
+    const size_type newCap = std::max(nextCapacity(), size_ + k);
+    MY_INSTRUMENT_ADD(T, reallocations, 1);
+    if (reallocateInPlace(newCap)) {
+        relocateRight(data_ + idx, size_ - idx, data_ + idx + k);
+        return;
+    }
+
+    pointer temp = __alloc_traits::allocate(allocator_, newCap);
+
+    try {
+        uninitialized_relocate(allocator_, data_, idx, temp);
+        uninitialized_relocate(allocator_, data_ + idx, size_ - idx, temp + idx + k);
+    } catch (...) {
+        __alloc_traits::deallocate(allocator_, temp, newCap);
+        throw;
+    }
+
+    __alloc_traits::deallocate(allocator_, data_, capacity_);
+
+    data_ = temp;
+    capacity_ = newCap;
+}
+
+// dest > first, so the copy runs back to front
+template <typename T, class Allocator>
+void vector<T, Allocator>::relocateRight(pointer first, size_type n, pointer dest)
+{
+    if constexpr (is_trivially_relocatable_v<T>) {
+        if (n)
+            std::memmove(static_cast<void*>(dest), static_cast<const void*>(first), n * sizeof(T));
+        MY_INSTRUMENT_ADD(T, relocations, n);
+    } else {
+        for (size_type i = n; i-- > 0;) {
+            __alloc_traits::construct(allocator_, dest + i, std::move(first[i]));
+            __alloc_traits::destroy(allocator_, first + i);
+        }
+    }
+}
+
+// dest < first, so the copy runs front to back
+template <typename T, class Allocator>
+void vector<T, Allocator>::relocateLeft(pointer first, size_type n, pointer dest)
+{
+    if constexpr (is_trivially_relocatable_v<T>) {
+        if (n)
+            std::memmove(static_cast<void*>(dest), static_cast<const void*>(first), n * sizeof(T));
+        MY_INSTRUMENT_ADD(T, relocations, n);
+    } else {
+        for (size_type i = 0; i < n; ++i) {
+            __alloc_traits::construct(allocator_, dest + i, std::move(first[i]));
+            __alloc_traits::destroy(allocator_, first + i);
+        }
+    }
+}
+
+template <typename T, class Allocator>
+template <class... Args>
+typename vector<T, Allocator>::reference
+vector<T, Allocator>::emplace_back(Args&&... args)
+{
+    if (size_ == capacity_) {
+        growAndEmplaceBack(std::forward<Args>(args)...);
+    } else {
+        __alloc_traits::construct(allocator_, data_ + size_, std::forward<Args>(args)...);
+        ++size_;
+    }
+
+    return back();
+}
+
+// The new element is built in the new buffer before the old ones move, so
+// v.push_back(v[0]) still reads v[0] from live memory
+template <typename T, class Allocator>
+template <class... Args>
+void vector<T, Allocator>::growAndEmplaceBack(Args&&... args)
+{
+    const size_type newCap = nextCapacity();
+
+    // The block may be resized in place, so take the new element out of it
+    // first (it's relocatable, so that's a cheap copy)
+    if constexpr (is_trivially_relocatable_v<T> && reallocating_allocator<Allocator, T>) {
+        value_type value(std::forward<Args>(args)...);
+        grow(newCap);
+        __alloc_traits::construct(allocator_, data_ + size_, std::move(value));
+        ++size_;
+        return;
+    }
+
+    MY_INSTRUMENT_ADD(T, reallocations, 1);
+    pointer temp = __alloc_traits::allocate(allocator_, newCap);
+
+    try {
+        __alloc_traits::construct(allocator_, temp + size_, std::forward<Args>(args)...);
+    } catch (...) {
+        __alloc_traits::deallocate(allocator_, temp, newCap);
+        throw;
+    }
+
+    try {
+        uninitialized_relocate(allocator_, data_, size_, temp);
+    } catch (...) {
+        __alloc_traits::destroy(allocator_, temp + size_);
+        __alloc_traits::deallocate(allocator_, temp, newCap);
+        throw;
+    }
+
+    __alloc_traits::deallocate(allocator_, data_, capacity_);
+
+    data_ = temp;
+    capacity_ = newCap;
     ++size_;
 }
 
+template <typename T, class Allocator>
+void vector<T, Allocator>::reserve(size_type newCap)
+{
+    if (newCap > max_size())
+        throw(std::length_error("vector::reserve"));
+
+    if (newCap > capacity_)
+        grow(newCap);
+}
+
+template <typename T, class Allocator>
+void vector<T, Allocator>::shrink_to_fit()
+{
+    if (capacity_ > size_)
+        grow(size_);
+}
+
 
 template <typename T, class Allocator>
 void vector<T, Allocator>::pop_back()
 {
     --size_;
-    std::allocator_traits<allocator_type>::destroy(allocator_, end());
+    __alloc_traits::destroy(allocator_, end());
 }
 
 
@@ -471,7 +852,7 @@ template <typename T, class Allocator>
 typename vector<T, Allocator>::iterator 
 vector<T, Allocator>::erase(iterator pos)
 {
-    using traits = std::allocator_traits<allocator_type>;
+    using traits = __alloc_traits;
     size_type idx = pos - begin();
 
     T* const out = data_ + idx;
@@ -485,31 +866,117 @@ vector<T, Allocator>::erase(iterator pos)
     return out;
 }
 
+template <typename T, class Allocator>
+typename vector<T, Allocator>::iterator 
+vector<T, Allocator>::erase(const_iterator first, const_iterator last)
+{
+    const size_type idx = first - cbegin();
+    const size_type k = last - first;
+
+    if (!k)
+        return data_ + idx;
+
+    for (size_type i = idx; i < idx + k; ++i)
+        __alloc_traits::destroy(allocator_, data_ + i);
+
+    relocateLeft(data_ + idx + k, size_ - idx - k, data_ + idx);
+    size_ -= k;
+
+    return data_ + idx;
+}
+
+
+// Grows geometrically like push_back so resizing by small steps stays O(1)
+// amortized, and never reallocates when it fits
+template <typename T, class Allocator>
+void vector<T, Allocator>::resize(size_type count)
+{
+    if (count <= size_) {
+        for (size_type i = count; i < size_; ++i)
+            __alloc_traits::destroy(allocator_, data_ + i);
+        size_ = count;
+        return;
+    }
+
+    if (count > capacity_)
+        grow(std::max(count, nextCapacity()));
+
+    for (; size_ < count; ++size_)
+        __alloc_traits::construct(allocator_, data_ + size_);
+}
 
 template <typename T, class Allocator>
 void vector<T, Allocator>::resize(size_type count, const_reference value)
-{    
-    using traits = std::allocator_traits<allocator_type>;
-    if (count == size_) return;
+{
+    if (count <= size_) {
+        resize(count);
+        return;
+    }
+
+    // value may live in this vector, copy it before a grow moves it
+    const value_type copy(value);
+    if (count > capacity_)
+        grow(std::max(count, nextCapacity()));
+
+    if constexpr (use_simd) {
+        simd::fill(data_ + size_, count - size_, copy);
+        MY_INSTRUMENT_ADD(T, copies, count - size_);
+        size_ = count;
+        return;
+    }
+
+    for (; size_ < count; ++size_)
+        __alloc_traits::construct(allocator_, data_ + size_, copy);
+}
 
-    const size_type n_to_move = (size_ < count) ? size_ : count;
+template <typename T, class Allocator>
+std::span<T> vector<T, Allocator>::resize_for_overwrite(size_type count)
+{
+    static_assert(std::is_trivially_default_constructible_v<T> && std::is_trivially_destructible_v<T>,
+                  "resize_for_overwrite leaves elements unconstructed, T has to allow that");
+
+    const size_type oldSize = size_;
+    if (count > capacity_)
+        grow(std::max(count, nextCapacity()));
 
-    auto new_data_ = traits::allocate(allocator_, count);
-    auto cur = new_data_;
+    size_ = count;
+    return count > oldSize ? std::span<T>(data_ + oldSize, count - oldSize) : std::span<T>();
+}
 
-    for (size_type i = 0; i < n_to_move; ++i, ++cur)
-            traits::construct(allocator_, cur, std::move(data_[i]));
+/*** Non-member functions ***/
+// not defined in STL
+// One read(2) of up to maxBytes straight into v's spare capacity, so the
+// bytes land in their final place with no zeroing or copy. Returns what
+// read() returned (> 0 bytes appended, 0 at EOF, -1 with errno set), retries
+// on EINTR. Works on sockets and pipes too
+template <typename T, class Allocator>
+ssize_t read_append(int fd, vector<T, Allocator> &v, std::size_t maxBytes)
+{
+    static_assert(sizeof(T) == 1 && std::is_trivially_copyable_v<T>,
+                  "read_append appends raw bytes, use a vector of char/unsigned char/std::byte");
 
-    for (auto it = begin(); it != end(); ++it)
-        traits::destroy(allocator_, it);
+    const std::size_t oldSize = v.size();
+    std::span<T> tail = v.append_uninitialized(maxBytes);
 
-    for (size_type i = n_to_move; i < capacity_; ++i)
-        traits::construct(allocator_, begin() + i, value);
+    ssize_t n;
+    do {
+        n = ::read(fd, tail.data(), tail.size());
+    } while (n < 0 && errno == EINTR);
+
+    v.resize_for_overwrite(oldSize + (n > 0 ? n : 0));
+    return n;
+}
+
+template <typename T, class Allocator>
+bool operator==(const vector<T, Allocator> &lhs, const vector<T, Allocator> &rhs)
+{
+    if (lhs.size() != rhs.size())
+        return false;
 
-    traits::deallocate(allocator_, data_, capacity_);
-    data_ = new_data_;
-    capacity_ = count;
-    size_ = n_to_move;
+    if constexpr (simd::vectorizable<T>)
+        return simd::equal(lhs.data(), rhs.data(), lhs.size());
+    else
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin());
 }
 
 }
@@ -3,25 +3,508 @@
 #include <random>
 #include <type_traits>
 #include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <bit>
+#include <ranges>
+#include <span>
+
+#include "my_simd.hpp"
+
+/*
+ * Random numbers
+ * random<T>() is a uniform [0, 1) for floating T and all of T's range for
+ * integers, random<T>(min, max) is [min, max) for floats and [min, max] for
+ * integers. Both draw from engine() (a thread_local mt19937_64) unless an
+ * engine is passed first:
+ *
+ *   auto &e = Rand::fast_engine();                 // xoshiro256++
+ *   double px  = Rand::random<double>(e, 99.0, 101.0);
+ *   int    qty = Rand::random<int>(e, 1, 100);
+ *   double z   = Rand::normal<double>(e);
+ *
+ * For bulk draws fill() writes a whole contiguous range per call. With
+ * xoshiro256pp_x4 (four interleaved xoshiro256++ streams) the raw bits come
+ * out of one AVX2 register at a time:
+ *
+ *   Rand::xoshiro256pp_x4 gen(42);
+ *   std::vector<double> noise(1 << 20);
+ *   Rand::fill_normal(gen, noise, 0.0, 0.01);
+ *
+ * Bounded integers use Lemire's multiply-shift, which only divides in the
+ * rare case a draw lands in the biased sliver. Normals and exponentials use
+ * 256 layer ziggurats, one draw and a compare almost every time.
+ *
+ * NOTE: floats get 52 (double) or 23 (float) random bits, the rest of the
+ *       mantissa is zero. Any engine works as long as it returns 64 full bits
+ */
 
 namespace Rand {
 
+template <class E>
+concept engine64 = std::uniform_random_bit_generator<std::remove_reference_t<E>>
+                   && std::remove_reference_t<E>::min() == 0
+                   && std::remove_reference_t<E>::max() == UINT64_MAX;
+
+// bool isn't a number to draw uniformly from, random<bool> would otherwise
+// come out true 255 times in 256
+template <class T>
+concept arithmetic = std::is_arithmetic_v<T> && !std::is_same_v<std::remove_cv_t<T>, bool>;
+
+template <class T>
+concept integer = arithmetic<T> && std::is_integral_v<T>;
+
+/*** Engines ***/
+// Turns any seed, even 0 or 1, into well mixed words. Used to seed xoshiro
+class splitmix64 {
+public:
+    using result_type = std::uint64_t;
+
+    explicit splitmix64(std::uint64_t seed = 0) noexcept : _state(seed) {}
+
+    std::uint64_t operator()() noexcept {
+        std::uint64_t z = (_state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    static constexpr std::uint64_t min() noexcept { return 0; }
+    static constexpr std::uint64_t max() noexcept { return UINT64_MAX; }
+
+private:
+    std::uint64_t _state;
+};
+
+// xoshiro256++ (Blackman & Vigna), 256 bits of state and a handful of
+// adds, shifts and xors per draw against mt19937_64's 2.5KB
+class xoshiro256pp {
+public:
+    using result_type = std::uint64_t;
+
+    explicit xoshiro256pp(std::uint64_t seed = 0) noexcept {
+        splitmix64 sm(seed);
+        for (auto &w : _s)
+            w = sm();
+    }
+
+    std::uint64_t operator()() noexcept {
+        const std::uint64_t out = std::rotl(_s[0] + _s[3], 23) + _s[0];
+        const std::uint64_t t = _s[1] << 17;
+        _s[2] ^= _s[0];
+        _s[3] ^= _s[1];
+        _s[1] ^= _s[2];
+        _s[0] ^= _s[3];
+        _s[2] ^= t;
+        _s[3] = std::rotl(_s[3], 45);
+        return out;
+    }
+
+    // Same as 2^128 calls, so streams jumped apart never overlap
+    void jump() noexcept {
+        constexpr std::uint64_t poly[] = {0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull,
+                                          0xa9582618e03fc9aaull, 0x39abdc4529b1661cull};
+        std::uint64_t s[4] = {};
+        for (std::uint64_t word : poly) {
+            for (int b = 0; b < 64; ++b) {
+                if (word & (1ull << b))
+                    for (int k = 0; k < 4; ++k)
+                        s[k] ^= _s[k];
+                (*this)();
+            }
+        }
+        std::copy(s, s + 4, _s);
+    }
+
+    const std::uint64_t (&state() const noexcept)[4] { return _s; }
+
+    static constexpr std::uint64_t min() noexcept { return 0; }
+    static constexpr std::uint64_t max() noexcept { return UINT64_MAX; }
+
+private:
+    std::uint64_t _s[4];
+};
+
+namespace detail {
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+// s is [word][lane], so each word of the four streams is one vector
+[[gnu::always_inline]] inline void xoshiroKernel(std::uint64_t (&s)[4][4], std::uint64_t *out,
+                                                 std::size_t blocks) noexcept {
+    using namespace My::simd::detail;
+    using V = vec<std::uint64_t, 32>;
+
+    V s0 = load<V>(s[0]), s1 = load<V>(s[1]), s2 = load<V>(s[2]), s3 = load<V>(s[3]);
+    for (std::size_t b = 0; b < blocks; ++b) {
+        const V sum = s0 + s3;
+        store(out + 4 * b, ((sum << 23) | (sum >> 41)) + s0);
+        const V t = s1 << 17;
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+        s2 ^= t;
+        s3 = (s3 << 45) | (s3 >> 19);
+    }
+    store(s[0], s0);
+    store(s[1], s1);
+    store(s[2], s2);
+    store(s[3], s3);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+[[gnu::target("avx2")]] inline void xoshiroAvx2(std::uint64_t (&s)[4][4], std::uint64_t *out,
+                                                std::size_t blocks) noexcept {
+    xoshiroKernel(s, out, blocks);
+}
+#endif
+
+// Whatever the build targets, two SSE2 registers per vector on plain x86-64
+inline void xoshiroDefault(std::uint64_t (&s)[4][4], std::uint64_t *out, std::size_t blocks) noexcept {
+    xoshiroKernel(s, out, blocks);
+}
+
+#pragma GCC diagnostic pop
+
+} // namespace detail
+
+// Four xoshiro256++ streams 2^128 apart, interleaved. generate() runs them
+// side by side in vector registers, operator() hands out a buffered block
+class xoshiro256pp_x4 {
+public:
+    using result_type = std::uint64_t;
+
+    explicit xoshiro256pp_x4(std::uint64_t seed = 0) noexcept {
+        xoshiro256pp lane(seed);
+        for (int l = 0; l < 4; ++l) {
+            for (int w = 0; w < 4; ++w)
+                _s[w][l] = lane.state()[w];
+            lane.jump();
+        }
+    }
+
+    std::uint64_t operator()() noexcept {
+        if (_pos == buffered) {
+            generate(_buf, buffered);
+            _pos = 0;
+        }
+        return _buf[_pos++];
+    }
+
+    // n raw draws into out, whole blocks of four at a time
+    void generate(std::uint64_t *out, std::size_t n) noexcept {
+        const std::size_t blocks = n / 4;
+#if defined(__x86_64__) || defined(__i386__)
+        if (My::simd::cpu == My::simd::isa::avx2)
+            detail::xoshiroAvx2(_s, out, blocks);
+        else
+#endif
+            detail::xoshiroDefault(_s, out, blocks);
+
+        if (n % 4) {
+            std::uint64_t tail[4];
+            detail::xoshiroDefault(_s, tail, 1);
+            std::copy(tail, tail + n % 4, out + 4 * blocks);
+        }
+    }
+
+    static constexpr std::uint64_t min() noexcept { return 0; }
+    static constexpr std::uint64_t max() noexcept { return UINT64_MAX; }
+
+private:
+    static constexpr std::size_t buffered = 16;
+
+    std::uint64_t _s[4][4];
+    std::uint64_t _buf[buffered];
+    std::size_t   _pos = buffered;
+};
+
 inline std::mt19937_64& engine() {
     static thread_local std::mt19937_64 e{ std::random_device{}() };
     return e;
 }
 
-template <typename T>
+inline xoshiro256pp& fast_engine() {
+    static thread_local xoshiro256pp e{ (std::uint64_t(std::random_device{}()) << 32) ^ std::random_device{}() };
+    return e;
+}
+
+namespace detail {
+
+// Exponent of 1.0 with random mantissa bits is uniform in [1, 2), minus one
+// it's [0, 1). No int to float conversion, so it vectorizes without AVX-512
+template <std::floating_point T>
+inline T toUnit(std::uint64_t bits) noexcept {
+    if constexpr (sizeof(T) == sizeof(std::uint64_t)) {
+        return std::bit_cast<T>((bits >> 12) | 0x3ff0000000000000ull) - T(1);
+    } else {
+        static_assert(sizeof(T) == sizeof(std::uint32_t), "float or double");
+        return std::bit_cast<T>(static_cast<std::uint32_t>(bits >> 41) | 0x3f800000u) - T(1);
+    }
+}
+
+// Top bits, the best ones for any engine
+template <integer T>
+inline T toInt(std::uint64_t bits) noexcept {
+    return static_cast<T>(bits >> (64 - 8 * sizeof(T)));
+}
+
+// Lemire: the high half of bits * range is uniform in [0, range) unless the
+// low half lands under 2^64 % range, then draw again
+template <engine64 Engine>
+inline std::uint64_t bounded(std::uint64_t bits, std::uint64_t range, Engine &e) {
+    unsigned __int128 m = static_cast<unsigned __int128>(bits) * range;
+    if (static_cast<std::uint64_t>(m) < range) {
+        const std::uint64_t threshold = (0 - range) % range;
+        while (static_cast<std::uint64_t>(m) < threshold)
+            m = static_cast<unsigned __int128>(e()) * range;
+    }
+    return static_cast<std::uint64_t>(m >> 64);
+}
+
+// max - min + 1 as an unsigned 64 bit range, 0 meaning all 2^64 values
+template <integer T>
+inline std::uint64_t rangeOf(T min, T max) noexcept {
+    using U = std::make_unsigned_t<T>;
+    return static_cast<std::uint64_t>(static_cast<U>(static_cast<U>(max) - static_cast<U>(min))) + 1;
+}
+
+template <integer T, engine64 Engine>
+inline T intIn(std::uint64_t bits, T min, std::uint64_t range, Engine &e) {
+    using U = std::make_unsigned_t<T>;
+    const std::uint64_t offset = range ? bounded(bits, range, e) : bits;
+    return static_cast<T>(static_cast<U>(static_cast<U>(min) + static_cast<U>(offset)));
+}
+
+/*** Ziggurat ***/
+// The density is covered by 256 equal area layers: 255 rectangles and a base
+// strip that ends in the tail. x[i] is the right edge of layer i (x[0] is
+// the base strip stretched into a rectangle of the same area), f[i] the
+// density at x[i]. A draw picks a layer and a point in it, and when that
+// point is left of the next layer's edge it's under the curve for sure
+struct ziggurat {
+    double x[257];
+    double f[257];
+
+    // r is where the tail starts, v the area of each layer
+    template <class Density, class Inverse>
+    ziggurat(double r, double v, Density density, Inverse inverse) {
+        x[0] = v / density(r);
+        x[1] = r;
+        for (int i = 1; i < 255; ++i)
+            x[i + 1] = inverse(v / x[i] + density(x[i]));
+        x[256] = 0;
+        for (int i = 0; i < 257; ++i)
+            f[i] = density(x[i]);
+    }
+};
+
+inline const ziggurat& normalTable() {
+    static const ziggurat table(3.6541528853610088, 0.00492867323399,
+                                [](double x) { return std::exp(-0.5 * x * x); },
+                                [](double y) { return std::sqrt(-2 * std::log(y)); });
+    return table;
+}
+
+inline const ziggurat& exponentialTable() {
+    static const ziggurat table(7.69711747013104972, 0.0039496598225815571993,
+                                [](double x) { return std::exp(-x); },
+                                [](double y) { return -std::log(y); });
+    return table;
+}
+
+// One standard normal starting from bits, e only gets touched when that
+// first try misses (about 1.2% of the time). The low 9 bits pick the layer
+// and sign, toUnit takes the top 52
+template <engine64 Engine>
+inline double normalFrom(std::uint64_t bits, Engine &e) {
+    const ziggurat &z = normalTable();
+    for (;;) {
+        const unsigned i = bits & 255;
+        const double x = toUnit<double>(bits) * z.x[i];
+        // Bit 8 moved up to the sign bit, a branch on it would miss half the time
+        const std::uint64_t sign = (bits & 256) << 55;
+
+        if (x < z.x[i + 1])
+            return std::bit_cast<double>(std::bit_cast<std::uint64_t>(x) ^ sign);
+
+        if (i == 0) {
+            // Tail past r (Marsaglia): r + a with a exponential, thinned
+            const double r = z.x[1];
+            double a, b;
+            do {
+                a = -std::log1p(-toUnit<double>(e())) / r;
+                b = -std::log1p(-toUnit<double>(e()));
+            } while (2 * b < a * a);
+            return std::bit_cast<double>(std::bit_cast<std::uint64_t>(r + a) ^ sign);
+        }
+
+        if (z.f[i] + toUnit<double>(e()) * (z.f[i + 1] - z.f[i]) < std::exp(-0.5 * x * x))
+            return std::bit_cast<double>(std::bit_cast<std::uint64_t>(x) ^ sign);
+        bits = e();
+    }
+}
+
+// Standard exponential, same layout without the sign bit
+template <engine64 Engine>
+inline double exponentialFrom(std::uint64_t bits, Engine &e) {
+    const ziggurat &z = exponentialTable();
+    for (;;) {
+        const unsigned i = bits & 255;
+        const double x = toUnit<double>(bits) * z.x[i];
+
+        if (x < z.x[i + 1])
+            return x;
+
+        // Memoryless, so the tail is just r plus another exponential
+        if (i == 0)
+            return z.x[1] - std::log1p(-toUnit<double>(e()));
+
+        if (z.f[i] + toUnit<double>(e()) * (z.f[i + 1] - z.f[i]) < std::exp(-x))
+            return x;
+        bits = e();
+    }
+}
+
+// Raw bits in chunks, vectorized when the engine can do blocks
+template <engine64 Engine, class F>
+inline void forEachChunk(Engine &e, std::size_t n, F f) {
+    constexpr std::size_t chunk = 512;
+    std::uint64_t bits[chunk];
+    for (std::size_t done = 0; done < n; done += chunk) {
+        const std::size_t m = std::min(chunk, n - done);
+        if constexpr (requires { e.generate(bits, m); }) {
+            e.generate(bits, m);
+        } else {
+            for (std::size_t i = 0; i < m; ++i)
+                bits[i] = e();
+        }
+        f(bits, done, m);
+    }
+}
+
+} // namespace detail
+
+/*** One value ***/
+template <typename T, engine64 Engine>
+requires std::is_floating_point_v<T>
+inline T random(Engine &e) {
+    return detail::toUnit<T>(e());
+}
+
+template <typename T, engine64 Engine>
 requires std::is_floating_point_v<T>
+inline T random(Engine &e, T min, T max) {
+    return min + (max - min)*random<T>(e);
+}
+
+template <typename T, engine64 Engine>
+requires integer<T>
+inline T random(Engine &e) {
+    return detail::toInt<T>(e());
+}
+
+// Inclusive, like std::uniform_int_distribution
+template <typename T, engine64 Engine>
+requires integer<T>
+inline T random(Engine &e, T min, T max) {
+    return detail::intIn(e(), min, detail::rangeOf(min, max), e);
+}
+
+template <typename T>
+requires arithmetic<T>
 inline T random() {
-    std::uniform_real_distribution<T> dis(T(0), T(1));
-    return dis(engine());
+    return random<T>(engine());
 }
 
 template <typename T>
-requires std::is_floating_point_v<T>
+requires arithmetic<T>
 inline T random(T min, T max) {
-    return min + (max - min)*random<T>();
+    return random<T>(engine(), min, max);
+}
+
+template <std::floating_point T, engine64 Engine>
+inline T normal(Engine &e, T mean = 0, T stddev = 1) {
+    return mean + stddev * static_cast<T>(detail::normalFrom(e(), e));
+}
+
+// rate is lambda, the mean is 1 / rate
+template <std::floating_point T, engine64 Engine>
+inline T exponential(Engine &e, T rate = 1) {
+    return static_cast<T>(detail::exponentialFrom(e(), e)) / rate;
+}
+
+/*** Batches ***/
+// Anything contiguous: std::span, std::vector, My::vector, arrays
+template <class R>
+concept fillable = std::ranges::contiguous_range<R> && std::ranges::sized_range<R>
+                   && arithmetic<std::ranges::range_value_t<R>>
+                   && !std::is_const_v<std::remove_reference_t<std::ranges::range_reference_t<R>>>;
+
+template <engine64 Engine, fillable R>
+inline void fill(Engine &e, R &&out) {
+    using T = std::ranges::range_value_t<R>;
+    T *p = std::ranges::data(out);
+    detail::forEachChunk(e, std::ranges::size(out), [p](const std::uint64_t *bits, std::size_t at, std::size_t m) {
+        for (std::size_t i = 0; i < m; ++i) {
+            if constexpr (std::is_floating_point_v<T>)
+                p[at + i] = detail::toUnit<T>(bits[i]);
+            else
+                p[at + i] = detail::toInt<T>(bits[i]);
+        }
+    });
+}
+
+// [min, max) for floats, [min, max] for integers
+template <engine64 Engine, fillable R, class T = std::ranges::range_value_t<R>>
+inline void fill(Engine &e, R &&out, std::type_identity_t<T> min, std::type_identity_t<T> max) {
+    T *p = std::ranges::data(out);
+    if constexpr (std::is_floating_point_v<T>) {
+        const T width = max - min;
+        detail::forEachChunk(e, std::ranges::size(out), [=](const std::uint64_t *bits, std::size_t at, std::size_t m) {
+            for (std::size_t i = 0; i < m; ++i)
+                p[at + i] = min + width * detail::toUnit<T>(bits[i]);
+        });
+    } else {
+        const std::uint64_t range = detail::rangeOf(min, max);
+        detail::forEachChunk(e, std::ranges::size(out), [&](const std::uint64_t *bits, std::size_t at, std::size_t m) {
+            for (std::size_t i = 0; i < m; ++i)
+                p[at + i] = detail::intIn(bits[i], min, range, e);
+        });
+    }
+}
+
+template <fillable R>
+inline void fill(R &&out) {
+    fill(engine(), out);
+}
+
+template <fillable R, class T = std::ranges::range_value_t<R>>
+inline void fill(R &&out, std::type_identity_t<T> min, std::type_identity_t<T> max) {
+    fill(engine(), out, min, max);
+}
+
+template <engine64 Engine, fillable R, class T = std::ranges::range_value_t<R>>
+requires std::is_floating_point_v<T>
+inline void fill_normal(Engine &e, R &&out, std::type_identity_t<T> mean = 0, std::type_identity_t<T> stddev = 1) {
+    T *p = std::ranges::data(out);
+    detail::forEachChunk(e, std::ranges::size(out), [&](const std::uint64_t *bits, std::size_t at, std::size_t m) {
+        for (std::size_t i = 0; i < m; ++i)
+            p[at + i] = mean + stddev * static_cast<T>(detail::normalFrom(bits[i], e));
+    });
+}
+
+template <engine64 Engine, fillable R, class T = std::ranges::range_value_t<R>>
+requires std::is_floating_point_v<T>
+inline void fill_exponential(Engine &e, R &&out, std::type_identity_t<T> rate = 1) {
+    T *p = std::ranges::data(out);
+    detail::forEachChunk(e, std::ranges::size(out), [&](const std::uint64_t *bits, std::size_t at, std::size_t m) {
+        for (std::size_t i = 0; i < m; ++i)
+            p[at + i] = static_cast<T>(detail::exponentialFrom(bits[i], e)) / rate;
+    });
 }
 
 } // namespace Rand